@@ -0,0 +1,29 @@
+// Regrafusion - draws graphics recursively
+// Distributed under GPL-3.0
+// Copyright (C) 2024  Vesko Milev
+
+/*! \file allocation_counter.h
+    \brief Counts heap allocations in debug builds, so that allocations on the drawing path are noticed when they creep back in.
+*/
+
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstdint>
+#include <QtGlobal>
+
+#ifdef QT_DEBUG
+//!  Whether heap allocations are counted; they're only counted in debug builds, as counting costs an atomic increment each
+constexpr bool kCountAllocations = true;
+#else
+constexpr bool kCountAllocations = false;
+#endif
+
+//!
+//! \return How many times the global operator new has been called by all threads since the program started, or 0 if
+//! allocations aren't counted
+//! \sa kCountAllocations
+//!
+uint64_t allocationCount();
+
+#endif // ALLOCATION_COUNTER_H
@@ -9,6 +9,8 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+#include <atomic>
+#include <cstdint>
 #include <numeric>
 #include <vector>
 
@@ -30,6 +32,24 @@ enum class leaf_type_t : char {
     invalid // has to be last member
 };
 
+//!  Mode of the program - in view and navigation modes some events aren't processed and the tree cannot be edited.
+//!  In navigation mode grid and rulers are drawn, whereas in view mode only the tree is drawn.
+//!  \sa RgfCtx::getMode()
+enum class ctx_mode_t {navigation, edit, view};
+
+//!
+//! Revisions mark changes to anything that is drawn. Since every new revision is greater than all previous ones, the greatest
+//! revision of a tree's parts changes whenever any of them changes, so frames are only drawn again when it does.
+//!
+//! \return A new revision, greater than all previously returned ones
+//! \sa Tree::getRevision()
+//!
+inline uint64_t nextRevision()
+{
+    static std::atomic<uint64_t> revision = 0;
+    return ++revision;
+}
+
 
 //!
 //! Averages all the values in a vector
@@ -38,7 +58,7 @@ enum class leaf_type_t : char {
 //! \return An average value of all the values of the vector
 //!
 template<class T>
-inline T vector_average(std::vector<T> input)
+inline T vector_average(const std::vector<T> &input)
 {
     if (input.size() == 0) {
         return 0;
@@ -54,7 +54,7 @@ public:
     bool handleEvent(QEvent *event);
 
 private:
-    std::vector<QPointF>& points() { return path_->points(); }
+    const std::vector<QPointF>& points() const { return path_->points(); }
 
     //!
     //! Draws the control onto the view area when the control is in Move Vertex mode
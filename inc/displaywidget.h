@@ -7,6 +7,7 @@
 #ifndef DISPLAYWIDGET_H
 #define DISPLAYWIDGET_H
 
+#include <vector>
 #include <QDragEnterEvent>
 #include <QDragMoveEvent>
 #include <QDropEvent>
@@ -16,6 +17,7 @@
 #include <QOpenGLWidget>
 
 #include "gfx/leaf.h"
+#include "renderer.h"
 #include "view.h"
 
 //!  A helper struct to represent the state of the 'ghost shape' that is displayed during Drag-and-Drop events
@@ -26,7 +28,20 @@ struct dragged_leaf_t
     QPointF position; //!<  Position of the ghost shape
 };
 
+//! Utility struct to record how long the phases of paintGL() that happen on the GUI thread take; the tree and everything below it
+//! are drawn by the render thread and recorded in TreeStatistics
+
+//! \sa DisplayWidget::paintGL()
+struct PaintStatistics
+{
+    TreeStatistics::Samples frame_time_us; //!< time to copy the displayed frame (or a preview of it) into the user view buffer
+    TreeStatistics::Samples overlay_time_us; //!< time to draw the dragged leaf, controls, rulers, labels and statistics
+    TreeStatistics::Samples blit_time_us; //!< time to draw the user view buffer onto the widget
+};
+
 class RgfCtx;
+class Tree;
+struct Frame;
 
 //!  DisplayWidget is the UI widget of the view area.
 
@@ -37,15 +52,25 @@ class DisplayWidget : public QOpenGLWidget
 
 public:
     DisplayWidget(QWidget* parent = NULL);
-\
+
+    ~DisplayWidget();
+
     //!
     //! This is the main drawing function. It draws the active buffer to the OpenGL canvas. The active buffer is usually the user view buffer,
     //! but it can be switched to the color id buffer for debug purposes.
+    //! The tree itself is drawn by the render thread; the newest frame it has finished is displayed, with the overlays on top of it.
     //!
-    //! \sa switchBuffers(), draw_user_view_buffer_
+    //! \sa switchBuffers(), draw_user_view_buffer_, refresh()
     //!
     void paintGL() override;
 
+    //!
+    //! Requests the render thread to draw a new frame and schedules a repaint. It should be called whenever the tree, the view
+    //! or the program state may have changed, whereas update() only repaints the last frame with up to date overlays.
+    //! If nothing that is drawn has actually changed, no frame is drawn and the last one is displayed again.
+    //!
+    void refresh();
+
     //!
     //! Resizes the OpenGL canvas and updates the internal View structure accordingly. Invocation of this function is handled by Qt framework.
     //!
@@ -103,12 +128,39 @@ public:
 
 private:
     //!
-    //! Initializes draw buffers with background colors and other default setttings
+    //! Captures everything that is needed to draw a frame of the current tree and view, except for the snapshot of the tree,
+    //! which is only taken once it's known that the frame has to be drawn
+    //!
+    //! \return The frame request, without a tree
+    //!
+    FrameRequest createFrameRequest() const;
+
+    //!
+    //! Draws a preview of the current view from the frames that have been drawn for other views, while the frame for the current
+    //! one is being drawn. Frames are scaled and shifted to the current view, coarser ones first, so that every part of the view
+    //! area shows the sharpest frame that contains it.
+    //!
+    //! \param painter A pointer to the user view painter
+    //! \sa zoom_levels_
+    //!
+    void drawPreview(std::shared_ptr<QPainter> painter);
+
+    //!
+    //! Keeps a complete frame as a zoom level for later previews, replacing any level of about the same scale and all levels that
+    //! show an outdated tree
+    //!
+    //! \param frame The frame
+    //!
+    void keepZoomLevel(const Frame &frame);
+
+    //!
+    //! Initializes the color id buffer with its background color and the view transformation, so that the tree can be drawn onto
+    //! it for debugging purposes
     //!
-    //! \param painter Pointer to the painter of the user view buffer
-    //! \param color_id_painter Pointer to the painter of the color id buffer
+    //! \return Pointer to the painter of the color id buffer
+    //! \sa switchBuffers()
     //!
-    void initializeDrawBuffers(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter);
+    std::shared_ptr<QPainter> initializeColorIdBuffer();
 
     //!
     //! Main entry point of view area UI event handling. Events are sorted and handled depending on internal state and event type.
@@ -211,6 +263,39 @@ private:
 
     //!  Indicator whether mouse dragging is occurring
     bool mouse_dragged_;
+
+    //!  Draws the tree on a dedicated thread
+    std::unique_ptr<Renderer> renderer_;
+
+    //!  Whether a new frame should be requested on the next paintGL()
+    //!  \sa refresh()
+    bool frame_requested_;
+
+    //!  The last request submitted to the render thread
+    FrameRequest submitted_request_;
+
+    //!  The frame that is currently displayed
+    std::shared_ptr<Frame> displayed_frame_;
+
+    //!  The tree snapshot of the displayed frame; leaves are picked from it, as that is what the user sees
+    std::shared_ptr<Tree> displayed_tree_;
+
+    //!  The view of the displayed frame
+    View displayed_view_;
+
+    //!  Recently displayed complete frames at distinct scales, oldest first, without their trees. While zooming, they're shown
+    //!  scaled until the frame for the new scale is finished, so that zooming back out to a recent scale shows a sharp frame at once.
+    //!  \sa drawPreview()
+    std::vector<Frame> zoom_levels_;
+
+    //!  Statistics about how fast the phases of paintGL() are drawn
+    PaintStatistics paint_stats_;
+
+    //!  How many zoom levels are kept
+    static constexpr size_t kMaxZoomLevels = 4;
+
+    //!  Frames whose scales differ by less than this factor replace each other as zoom levels
+    static constexpr qreal kZoomLevelScaleTolerance = 0.01;
 };
 
 #endif // DISPLAYWIDGET_H
@@ -24,8 +24,8 @@ struct BranchStatistics
     //!  Drawing time of the branch with highest depth
     uint last_branch_render_time_us;
 
-    //!  A vector containing drawing times of all branches
-    std::vector<uint> branch_render_times_us;
+    //!  Average drawing time of a branch over all depths
+    uint avg_branch_render_time_us;
 
     uint num_branches;
 };
@@ -43,15 +43,10 @@ public:
     Branch(std::weak_ptr<RgfCtx> ctx);
 
     //!
-    //! Draws instances of all leaves onto the view area and the color id buffer for the current depth level
+    //! \return All leaves of the branch in drawing order
+    //! \sa DisplayList
     //!
-    //! \param painter A pointer to the painter that paints onto the view area (view buffer)
-    //! \param color_id_painter A pointer to painter that paints onto the color id buffer
-    //! \param num_iterations How many instances of this branch are left to be drawn
-    //! \param stats A reference to this Branch's statistics
-    //! \param depth Which consecutive branch the leaf instances are on
-    //!
-    void draw(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter, uint num_iterations, BranchStatistics& stats, uint depth);
+    const std::vector<std::shared_ptr<Leaf>> & leaves() const { return leaves_; }
 
     //!
     //! Deselects all leaves of the branch
@@ -63,6 +58,15 @@ public:
     //!
     QTransform getSpawnPointTransformation();
 
+    //!
+    //! Sets the transformation matrix of the Spawn Point leaf. A branch has exactly one, which is created along with it.
+    //!
+    //! \param transformation The new transformation
+    //! \return Whether the setting was successful
+    //! \sa Leaf::setTransformationMatrix()
+    //!
+    bool setSpawnPointTransformation(QTransform transformation);
+
     //!
     //! Removes a leaf from the branch
     //!
@@ -70,6 +74,13 @@ public:
     //!
     void deleteLeaf(std::shared_ptr<Leaf> leaf);
 
+    //!
+    //! \return The greatest revision of the branch and its leaves, which changes whenever anything about the branch that is
+    //! drawn changes
+    //! \sa nextRevision()
+    //!
+    uint64_t getRevision() const;
+
     //!
     //! Creates a leaf in the branch
     //!
@@ -80,7 +91,23 @@ public:
     //!
     std::shared_ptr<Leaf> createLeaf(leaf_type_t leaf_type, QPointF position, qreal scale);
 
+    //!
+    //! Creates a copy of the branch with clones of all of its leaves
+    //!
+    //! \return A pointer to the copy
+    //! \sa Leaf::clone()
+    //!
+    std::unique_ptr<Branch> clone() const;
+
 private:
+    //!
+    //! Creates a branch with the given leaves, instead of with a new spawn point
+    //!
+    //! \param ctx A pointer to the context
+    //! \param leaves The leaves of the branch
+    //!
+    Branch(std::weak_ptr<RgfCtx> ctx, std::vector<std::shared_ptr<Leaf>> leaves);
+
     // disable copy and assignment ctors
     Branch(const Branch&) = delete;
     Branch& operator=(const Branch&) = delete;
@@ -89,6 +116,9 @@ private:
 
     //!  A vector containing all leaves of the branch
     std::vector<std::shared_ptr<Leaf>> leaves_;
+
+    //!  Revision of the last change to the branch's leaves, i.e. of the last leaf that has been added or removed
+    uint64_t revision_;
 };
 
 #endif // BRANCH_H
@@ -0,0 +1,338 @@
+// Regrafusion - draws graphics recursively
+// Distributed under GPL-3.0
+// Copyright (C) 2024  Vesko Milev
+
+/*! \file display_list.h */
+
+#ifndef DISPLAY_LIST_H
+#define DISPLAY_LIST_H
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <QImage>
+#include <QPainter>
+#include <QRegion>
+#include <QThreadPool>
+#include <QTransform>
+
+#include "gfx/branch.h"
+
+class Leaf;
+class LeafIdentifier;
+
+//!  A single leaf instance, i.e. a leaf at a given depth, along with everything needed to draw it
+
+//! \sa DisplayList
+struct LeafInstance
+{
+    //!  The drawn leaf. It's owned by its branch; the display list is recompiled every frame, so it never outlives it.
+    Leaf *leaf;
+
+    //!  Absolute transformation of the instance, i.e. from leaf space to the space of the painter's device
+    QTransform transform;
+
+    //!  Which consecutive branch the leaf instance is on
+    uint depth;
+
+    //!  Bounding rectangle of the instance in the painter's device space
+    QRectF bounds;
+};
+
+//!  A flattened, z-ordered list of all leaf instances of a tree.
+
+//!  The tree is walked once per frame (without recursion) and the absolute transformation of each instance is calculated
+//!  by only multiplying matrices, never inverting them. Instances are stored in the exact order in which the recursion would have
+//!  drawn them, so their position within the list is their z-order.
+//! \sa Tree, Branch, LeafInstance
+class DisplayList
+{
+public:
+    DisplayList();
+
+    //!
+    //! Walks the branches and (re)builds the list of instances. Instances that are outside the visible area or smaller than a pixel
+    //! are culled, i.e. they aren't added to the list at all. If the spawn transformation is a contraction, whole subtrees are
+    //! culled the same way, without walking their depths.
+    //!
+    //! \param branches The root branches of the tree
+    //! \param num_branches How many branch instances should be drawn
+    //! \param root_transform Transformation of the root branches, i.e. from world space to the painter's device space
+    //! \param visible_area The area of the painter's device that is visible
+    //! \param draw_state Program state that the instances are going to be drawn according to; the bounds of instances contain
+    //! everything drawn for them in that state, e.g. the selection in edit mode
+    //! \param min_branch_size If greater than 0, branches smaller than this (in pixels) aren't spawned, even if there should be
+    //! more branch instances. Only applies if the spawn transformation is a contraction, so that no deeper branch can be bigger.
+    //!
+    void compile(const std::vector<std::unique_ptr<Branch>> &branches, uint num_branches, const QTransform &root_transform,
+                 const QRectF &visible_area, const LeafDrawState &draw_state, qreal min_branch_size = 0);
+
+    //!
+    //! Draws all instances onto the view area, but not the controls of selected leaves, which aren't part of the tree.
+    //! Each instance's transformation overwrites the painter's world transformation, which is restored afterwards. If the
+    //! painter paints onto a 32-bit image, the visible area is split into tiles that are drawn in parallel by a thread pool,
+    //! each tile only drawing the instances that touch it. If most instances touch a single tile though, the list is split into
+    //! contiguous slices instead, which are drawn in parallel onto transparent layers that are then composited in z-order.
+    //! The selection is drawn last, on top of all instances.
+    //!
+    //! \param painter A pointer to the painter that paints onto the view area (view buffer)
+    //! \param draw_state Program state that the instances are drawn according to. It's kept for later color id passes.
+    //! \param stats A reference to the branch statistics, which are filled with per depth drawing times
+    //! \param color_id_painter If not null, a pointer to painter that paints onto the color id buffer. All instances are then
+    //! drawn onto the color id buffer as well, by a separate thread while the view area is being drawn.
+    //! \param leaf_identifier The leaf identifier that assigns colors to instances in the color id buffer; required if
+    //! color_id_painter isn't null
+    //!
+    void draw(std::shared_ptr<QPainter> painter, const LeafDrawState &draw_state, BranchStatistics &stats,
+              std::shared_ptr<QPainter> color_id_painter = nullptr, LeafIdentifier *leaf_identifier = nullptr);
+
+    //!
+    //! Starts drawing the instances incrementally, without drawing anything yet
+    //!
+    //! \param draw_state Program state that the instances are drawn according to
+    //! \param drawn_area If not empty, only instances that touch this part of the visible area are drawn. Painters are expected
+    //! to be clipped to it.
+    //! \sa drawNext()
+    //!
+    void beginDraw(const LeafDrawState &draw_state, const QRegion &drawn_area = QRegion());
+
+    //!
+    //! Continues an incremental draw. Instances are drawn in z-order, in chunks whose size is estimated from how long the
+    //! previous ones took, until the time budget is used up. Everything drawn by consecutive calls onto the same image looks
+    //! the same as if it had been drawn by a single draw(), including the selection, which is drawn by the call that finishes.
+    //!
+    //! \param painter A pointer to the painter that paints onto the view area; it may differ between calls, but its device
+    //! should contain everything drawn by the previous ones
+    //! \param budget How long to draw for; the last chunk may exceed it
+    //! \return Whether all instances have been drawn
+    //! \sa beginDraw()
+    //!
+    bool drawNext(std::shared_ptr<QPainter> painter, std::chrono::nanoseconds budget);
+
+    //!
+    //! Fills branch statistics with the drawing times of the first and the last depth of the last draw, and their average
+    //!
+    //! \param stats A reference to the branch statistics
+    //!
+    void getStatistics(BranchStatistics &stats) const;
+
+    //!
+    //! Draws instances onto the color id buffer as a new pass of the leaf identifier
+    //!
+    //! \param color_id_painter A pointer to painter that paints onto the color id buffer
+    //! \param leaf_identifier The leaf identifier that assigns colors to the drawn instances
+    //! \param area If valid, only instances that intersect this area of the painter's device are drawn
+    //!
+    void drawColorIds(std::shared_ptr<QPainter> color_id_painter, LeafIdentifier &leaf_identifier, const QRectF &area = QRectF());
+
+    //!
+    //! Finds the topmost instance at a given position by testing it against the shapes of the instances, without drawing anything
+    //!
+    //! \param position The position in the painter's device space
+    //! \return A pointer to the instance or nullptr if there is none. It's valid until the next compile().
+    //!
+    const LeafInstance * pick(QPointF position) const;
+
+    const std::vector<LeafInstance> & instances() const { return instances_; }
+
+    //!
+    //! \return How many branch instances deep the last compiled list actually goes, after culling and adaptive depth
+    //!
+    uint getEffectiveDepth() const { return num_depths_; }
+
+private:
+    // disable copy and assignment ctors
+    DisplayList(const DisplayList&) = delete;
+    DisplayList& operator=(const DisplayList&) = delete;
+
+    //!  A branch whose leaves are yet to be processed by compile(); replaces a call stack frame of the recursion
+    struct PendingBranch
+    {
+        const Branch *branch;
+        QTransform transform;
+        uint depth;
+        size_t next_leaf;
+    };
+
+    //!  All instances in z-order
+    std::vector<LeafInstance> instances_;
+
+    //!  Indices of the instances of selected leaves, at any depth; usually there are none or a few, so the selection pass
+    //! doesn't have to walk all instances
+    std::vector<size_t> selected_instances_;
+
+    //!
+    //! Appends an instance to the list, keeping track of it if its leaf is selected
+    //!
+    //! \param instance The instance
+    //!
+    void addInstance(const LeafInstance &instance);
+
+    //!
+    //! \param bounds Bounding rectangle of an instance in device space
+    //! \param visible_area The area of the painter's device that is visible
+    //! \return Whether the instance wouldn't contribute anything visible to the frame
+    //!
+    static bool isCulled(const QRectF &bounds, const QRectF &visible_area);
+
+    //!
+    //! Calculates a rectangle in branch space that contains an instance of the branch and all instances spawned by it.
+    //! Such a rectangle only exists if the branch has a single spawn point and its transformation is a contraction.
+    //! Expects the leaf and branch bounds to be calculated already.
+    //!
+    //! \param branch The branch
+    //!
+    void calculateTailBounds(const Branch &branch);
+
+    //!  Instances whose both dimensions are smaller than this (in pixels) aren't drawn
+    static constexpr qreal kMinInstanceSize = 1.0;
+
+    //!  A square part of the visible area that is drawn by a single thread
+    struct Tile
+    {
+        //!  The area of the tile in device space
+        QRect rect;
+
+        //!  Indices of the instances that touch the tile, in z-order
+        std::vector<uint32_t> instances;
+
+        //!  Drawing times per depth in nanoseconds, accumulated by the tile's thread
+        std::vector<uint64_t> render_times_ns;
+    };
+
+    //!  A contiguous range of the list that is drawn by a single thread onto its own layer
+    struct Slice
+    {
+        //!  Index of the first instance of the slice
+        size_t begin;
+
+        //!  Index after the last instance of the slice
+        size_t end;
+
+        //!  The area of the layer in device space
+        QRect rect;
+
+        //!  A transparent image that the instances are drawn onto
+        QImage layer;
+
+        //!  Drawing times per depth in nanoseconds, accumulated by the slice's thread
+        std::vector<uint64_t> render_times_ns;
+    };
+
+    //!
+    //! Draws a range of instances, in parallel tiles or slices if possible
+    //!
+    //! \param painter A pointer to the painter that paints onto the view area
+    //! \param begin Index of the first instance to draw
+    //! \param end Index after the last instance to draw
+    //!
+    void drawRange(QPainter *painter, size_t begin, size_t end);
+
+    //!
+    //! Splits an area into tiles and sorts a range of instances into all tiles they touch
+    //!
+    //! \param area The area to split, in device space
+    //! \param begin Index of the first instance to sort
+    //! \param end Index after the last instance to sort
+    //! \return The number of instances in the tile with the most instances
+    //!
+    size_t sortIntoTiles(const QRect &area, size_t begin, size_t end);
+
+    //!
+    //! Draws the instances that have been sorted into tiles onto an image tile by tile, using the thread pool
+    //!
+    //! \param painter A pointer to the painter that paints onto the image; only its render hints are used
+    //! \param buffer The image the painter paints onto
+    //!
+    void drawTiles(QPainter *painter, QImage &buffer);
+
+    //!
+    //! Draws a range of instances slice by slice, using the thread pool, and composites the slices using the painter
+    //!
+    //! \param painter A pointer to the painter that paints onto the view area
+    //! \param area The visible area in device space
+    //! \param begin Index of the first instance to draw
+    //! \param end Index after the last instance to draw
+    //!
+    void drawSlices(QPainter *painter, const QRect &area, size_t begin, size_t end);
+
+    //!
+    //! Draws a single instance and records the time it took
+    //!
+    //! \param context The context to draw with, built once per painter
+    //! \param instance The instance to draw
+    //! \param device_transform Transformation from the device space of the display list to that of the context's painter
+    //! \param render_times_ns Drawing times per depth, which the drawing time is added to
+    //!
+    void drawInstance(RenderContext &context, const LeafInstance &instance, const QTransform &device_transform,
+                      std::vector<uint64_t> &render_times_ns) const;
+
+    //!
+    //! Draws the selection of the selected leaf instance on top of all others, if the program is in edit mode. It's a separate
+    //! pass, so that drawing the other instances doesn't depend on the selection at all.
+    //!
+    //! \param painter A pointer to the painter that paints onto the view area
+    //!
+    void drawSelection(QPainter *painter);
+
+    //!  Antialiasing may bleed this far (in pixels) outside of an instance's bounding rectangle
+    static constexpr int kAntialiasingMargin = 1;
+
+    //!  Side of a tile in pixels
+    static constexpr int kTileSize = 256;
+
+    //!  If a single tile contains more than this share of the drawn instances, slices are used instead of tiles
+    static constexpr qreal kMaxTileShare = 0.5;
+
+    //!  Least number of instances that drawNext() draws at once, so that threads aren't started for just a few instances
+    static constexpr size_t kMinChunkSize = 256;
+
+    //!  How far (in pixels) from a line the cursor may be and still select it
+    static constexpr qreal kPickTolerance = 2.5;
+
+    //!  Local bounding rectangles of the leaves of the currently compiled branch, indexed the same way as the leaves.
+    //! Spawn points spawn instances of their own branch, so it's calculated once per root branch, instead of once per instance.
+    std::vector<QRectF> leaf_bounds_;
+
+    //!  Branch space bounds of all leaves of the currently compiled branch
+    QRectF branch_bounds_;
+
+    //!  Whether the tail bounds of the currently compiled branch are known
+    bool has_tail_bounds_;
+
+    //!  Branch space bounds of an instance of the currently compiled branch together with everything it spawns
+    QRectF tail_bounds_;
+
+    //!  Explicit stack used by compile(); it's a member only so that its capacity is reused between frames
+    std::vector<PendingBranch> pending_branches_;
+
+    //!  Accumulated drawing times per depth in nanoseconds, summed over all threads; a member only so that its capacity is reused
+    //! between frames
+    std::vector<uint64_t> depth_render_times_ns_;
+
+    //!  Index of the first instance that the current incremental draw hasn't drawn yet
+    size_t next_instance_;
+
+    //!  The visible area the list was compiled for
+    QRectF visible_area_;
+
+    //!  The part of the visible area that the current draw is restricted to
+    QRegion drawn_area_;
+
+    //!  Tiles of the last drawn frame; a member only so that their capacity is reused between frames
+    std::vector<Tile> tiles_;
+
+    //!  Slices of the last frame drawn in slices; a member so that layers are reused between frames
+    std::vector<Slice> slices_;
+
+    //!  Program state of the last drawn frame
+    LeafDrawState draw_state_;
+
+    //!  Threads that draw tiles and slices; shared by all display lists
+    QThreadPool *thread_pool_;
+
+    //!  Number of depths the list spans, i.e. the deepest instance's depth + 1
+    uint num_depths_;
+};
+
+#endif // DISPLAY_LIST_H
@@ -7,6 +7,7 @@
 #ifndef LEAF_H
 #define LEAF_H
 
+#include <cstdint>
 #include <QColor>
 #include <QEvent>
 #include <QMimeData>
@@ -18,6 +19,83 @@
 
 class RgfCtx;
 
+//!  Program state that affects how leaf instances are drawn. It's captured once per frame, so that leaves don't have to query
+//!  the context while they're being drawn, which may happen on the render thread.
+struct LeafDrawState
+{
+    //!  Mode of the program
+    ctx_mode_t mode;
+
+    //!  Depth of the selected leaf instance
+    uint selected_leaf_depth;
+
+    //!  Scale of the view
+    qreal view_scale;
+
+    bool operator==(const LeafDrawState &other) const
+    {
+        return mode == other.mode && selected_leaf_depth == other.selected_leaf_depth && view_scale == other.view_scale;
+    }
+};
+
+//!  Everything that leaf instances are drawn with. It's built once per painter per frame and passed by reference, so that
+//!  drawing an instance copies no smart pointers and doesn't look anything up. It also keeps track of the painter's pen and
+//!  brush, so that consecutive instances of the same style don't change them again; state changes are costly in the raster
+//!  engine. Leaves have to set them through the context for that to work.
+struct RenderContext
+{
+    //!
+    //! \param painter A pointer to the painter to draw with
+    //! \param state Program state of the drawn frame
+    //!
+    RenderContext(QPainter *painter, const LeafDrawState &state) :
+        painter(painter),
+        state(state),
+        pen_(painter->pen()),
+        brush_(painter->brush())
+    {
+    }
+
+    //!
+    //! Sets the painter's pen, unless an equal one is set already
+    //!
+    //! \param pen The pen
+    //!
+    void setPen(const QPen &pen)
+    {
+        if (pen != pen_) {
+            pen_ = pen;
+            painter->setPen(pen);
+        }
+    }
+
+    //!
+    //! Sets the painter's brush, unless an equal one is set already
+    //!
+    //! \param brush The brush
+    //!
+    void setBrush(const QBrush &brush)
+    {
+        if (brush != brush_) {
+            brush_ = brush;
+            painter->setBrush(brush);
+        }
+    }
+
+    //!  The painter to draw with; it's owned by whoever built the context and outlives it
+    QPainter *painter;
+
+    //!  Program state of the drawn frame
+    LeafDrawState state;
+
+private:
+    //!  The painter's current pen
+    QPen pen_;
+
+    //!  The painter's current brush
+    QBrush brush_;
+};
+
 //!  Leaf is the abstract parent class of all objects (shapes) displayed in the view area, as well as of the spawn points
 class Leaf : public QObject
 {
@@ -52,13 +130,32 @@ public:
     static void insertType(QMimeData *mime_data, leaf_type_t type);
 
     //!
-    //! Draws a leaf instance onto the view area and the color id buffer
+    //! Draws a leaf instance onto the view area, without any selection outline. The painter's world transformation is expected
+    //! to already be set to the instance's absolute transformation.
     //!
-    //! \param painter A pointer to the painter that paints onto the view area (view buffer)
-    //! \param color_id_painter A pointer to painter that paints onto the color id buffer
+    //! \param context The context to draw with; its painter paints onto the view area (view buffer)
     //! \param depth Which consecutive branch the leaf instance is on
     //!
-    virtual void draw(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter, uint depth);
+    virtual void draw(RenderContext &context, uint depth) = 0;
+
+    //!
+    //! Draws the outline and the transformation matrix of the selected leaf instance, but not its shape again, so that instances
+    //! above it still cover it. It's called by a separate pass after all instances have been drawn, so that the instances
+    //! themselves don't have to check whether they're selected.
+    //!
+    //! \param context The context to draw with; its painter paints onto the view area (view buffer)
+    //! \sa DisplayList::drawSelection()
+    //!
+    virtual void drawSelection(RenderContext &context);
+
+    //!
+    //! Draws a leaf instance onto the color id buffer. The painter's world transformation is expected to already be set to the
+    //! instance's absolute transformation.
+    //!
+    //! \param context The context to draw with; its painter paints onto the color id buffer
+    //! \param color The color that identifies the leaf instance, as assigned by LeafIdentifier
+    //!
+    virtual void drawColorId(RenderContext &context, QColor color) = 0;
 
     //!
     //! Draws a ghost shape under the cursor when a Drag-and-Drop event is occurring to visualise where exactly the new leaf would be
@@ -79,11 +176,46 @@ public:
     //!
     static std::shared_ptr<Leaf> constructNew(std::shared_ptr<RgfCtx> ctx, leaf_type_t leaf_type);
 
+    //!
+    //! Creates a detached copy of the leaf for a snapshot of the tree. The copy keeps the leaf's id and selection, but it isn't
+    //! registered with LeafIdentifier and has no controls.
+    //!
+    //! \return A pointer to the copy
+    //! \sa Tree::snapshot()
+    //!
+    virtual std::shared_ptr<Leaf> clone() const = 0;
+
     //!
     //! \return Whether the leaf is a spawn point
     //!
     virtual inline bool isSpawnPoint() = 0;
 
+    //!
+    //! \return A rectangle that contains everything the leaf draws, in the leaf's local space (i.e. without its matrix applied)
+    //!
+    virtual QRectF getBoundingRect() const = 0;
+
+    //!
+    //! \param view_scale Scale of the view
+    //! \return A rectangle that contains everything the leaf draws onto the color id buffer, in the leaf's local space. It's
+    //! larger than getBoundingRect() for leaves whose color id shape is widened, so that they're easier to select.
+    //!
+    virtual QRectF getColorIdBoundingRect(qreal view_scale) const { return getBoundingRect(); }
+
+    //!
+    //! \return A rectangle that contains the transformation matrix that drawSelection() draws, in the leaf's local space
+    //!
+    static QRectF getSelectionBoundingRect();
+
+    //!
+    //! Checks whether a point hits the leaf
+    //!
+    //! \param point The point, in the leaf's local space
+    //! \param tolerance How far (in local space) from shapes without area (e.g. lines) the point may be and still hit them
+    //! \return Whether the point hits the leaf
+    //!
+    virtual bool contains(QPointF point, qreal tolerance) const = 0;
+
     //!
     //! A setter function for the transformation matrix. It succeeds only if the parameter is an invertible matrix,
     //! i.e. if it's of non zero scale and if it doesn't squish the shape onto a single line.
@@ -94,21 +226,15 @@ public:
     //!
     bool setTransformationMatrix(QTransform matrix);
 
-    QTransform& matrix() { return matrix_; }
+    const QTransform& matrix() const { return matrix_; }
 
     //!
-    //! A utility function to remove the effects of the leaf's matrix from a painter's transformations
+    //! \return The revision of the leaf's last change that affects how it's drawn
+    //! \sa nextRevision()
     //!
-    //! \param painter A pointer to the painter that should "forget" this leaf's transformations
-    //!
-    inline void unapplyLocalTransformations(std::shared_ptr<QPainter> painter) {
-        if (!matrix_.isIdentity()) {
-            // combine param is true, so combine matrix_ with the existing transformations instead of overwriting them
-            painter->setWorldTransform(matrix_.inverted(), true);
-        }
-    }
+    uint64_t getRevision() const { return revision_; }
 
-    QColor getColorId() const { return color_id_; }
+    uint32_t getId() const { return id_; }
 
     //!
     //! Sets internal selected_ flag to true and creates the associated leaf controls
@@ -164,14 +290,6 @@ signals:
     void transformedNatively();
 
 protected:
-    //!
-    //! Calculates the color using which the leaf instance should be drawn in the color id buffer, based on its color id and its depth
-    //!
-    //! \param depth The depth this leaf instance is at
-    //! \return True if the event has been processed and should be blocked
-    //!
-    QColor getUniqueColor(uint depth);
-
     //!
     //! Creates controls (widgets in the view area) to modify the leaf
     //!
@@ -182,11 +300,41 @@ protected:
     //!
     void destroyControls();
 
+    //!
+    //! Copies the state that all leaves have onto a clone
+    //!
+    //! \param clone The clone
+    //! \sa clone()
+    //!
+    void copyTo(Leaf &clone) const;
+
+    //!
+    //! Assigns a new revision to the leaf; it has to be called whenever anything that affects how the leaf is drawn changes
+    //!
+    //! \sa getRevision()
+    //!
+    void markModified() { revision_ = nextRevision(); }
+
     std::weak_ptr<RgfCtx> ctx_;
 
-    //!  A color that uniquely identifies the leaf in the color id buffer (though this isn't necessarily the color used to draw
-    //! the leaf there - see getUniqueColor())
-    QColor color_id_;
+    //!  A margin (in local space) by which bounding rectangles are enlarged, so that they contain outlines as well.
+    //! It's the half width of the widest pen that leaves use for outlines.
+    //! \sa getBoundingRect()
+    static constexpr qreal kOutlineMargin = 1.0;
+
+    //!  Length of the axes of the transformation matrix drawn over the selected leaf instance, in local space. In principle it
+    //! should be 1, but 1 pixel is too short of a length.
+    static constexpr qreal kSelectionMatrixSide = 30.0;
+
+    //!  Pen of the outline of the selected leaf instance. Pens and brushes are built once, since building them allocates, whereas
+    //! setting a copy only shares it.
+    static const QPen kSelectionPen;
+
+    //!  Pen of shapes that are drawn without an outline
+    static const QPen kNoOutlinePen;
+
+    //!  A number that uniquely identifies the leaf, assigned by LeafIdentifier
+    uint32_t id_;
 
     //!  Whether the leaf is selected in the view area
     bool selected_;
@@ -207,6 +355,9 @@ private:
 
     //!  This leaf's transformation matrix
     QTransform matrix_;
+
+    //!  Revision of the leaf's last change
+    uint64_t revision_;
 };
 
 
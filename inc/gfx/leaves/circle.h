@@ -35,13 +35,38 @@ public:
     static std::shared_ptr<Circle> constructNew(std::weak_ptr<RgfCtx> ctx);
 
     //!
-    //! Draws a leaf instance onto the view area and the color id buffer
+    //! Creates a detached copy of the leaf for a snapshot of the tree
     //!
-    //! \param painter A pointer to the painter that paints onto the view area (view buffer)
-    //! \param color_id_painter A pointer to painter that paints onto the color id buffer
+    //! \return A pointer to the copy
+    //! \sa Leaf::clone()
+    //!
+    std::shared_ptr<Leaf> clone() const override;
+
+    //!
+    //! Draws a leaf instance onto the view area, without any selection outline. The painter's world transformation is expected
+    //! to already be set to the instance's absolute transformation.
+    //!
+    //! \param context The context to draw with; its painter paints onto the view area (view buffer)
     //! \param depth Which consecutive branch the leaf instance is on
     //!
-    void draw(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter, uint depth) override;
+    void draw(RenderContext &context, uint depth) override;
+
+    //!
+    //! Draws the outline of the selected leaf instance, along with its transformation matrix
+    //!
+    //! \param context The context to draw with; its painter paints onto the view area (view buffer)
+    //! \sa Leaf::drawSelection()
+    //!
+    void drawSelection(RenderContext &context) override;
+
+    //!
+    //! Draws a leaf instance onto the color id buffer. The painter's world transformation is expected to already be set to the
+    //! instance's absolute transformation.
+    //!
+    //! \param context The context to draw with; its painter paints onto the color id buffer
+    //! \param color The color that identifies the leaf instance, as assigned by LeafIdentifier
+    //!
+    void drawColorId(RenderContext &context, QColor color) override;
 
     //!
     //! Draws a ghost shape under the cursor when a Drag-and-Drop event is occurring to visualise where exactly the new leaf would be
@@ -54,13 +79,27 @@ public:
 
     inline bool isSpawnPoint() override { return false; }
 
+    //!
+    //! \return A rectangle that contains everything the leaf draws, in the leaf's local space (i.e. without its matrix applied)
+    //!
+    QRectF getBoundingRect() const override;
+
+    //!
+    //! Checks whether a point hits the leaf
+    //!
+    //! \param point The point, in the leaf's local space
+    //! \param tolerance How far (in local space) from shapes without area (e.g. lines) the point may be and still hit them
+    //! \return Whether the point hits the leaf
+    //!
+    bool contains(QPointF point, qreal tolerance) const override;
+
     qreal getRadius() const { return radius_; }
 
-    void setRadius(qreal radius) { radius_ = radius; }
+    void setRadius(qreal radius) { radius_ = radius; markModified(); }
 
     QColor getColor() const { return color_; }
 
-    void setColor(QColor color) { color_ = color; }
+    void setColor(QColor color) { color_ = color; brush_ = QBrush(color); markModified(); }
 
 private:
     //!
@@ -74,6 +113,9 @@ private:
     qreal radius_;
 
     QColor color_;
+
+    //!  A brush of the color, built once instead of for every drawn instance
+    QBrush brush_;
 };
 
 #endif // CIRCLE_H
@@ -35,13 +35,38 @@ public:
     static std::shared_ptr<Line> constructNew(std::weak_ptr<RgfCtx> ctx);
 
     //!
-    //! Draws a leaf instance onto the view area and the color id buffer
+    //! Creates a detached copy of the leaf for a snapshot of the tree
     //!
-    //! \param painter A pointer to the painter that paints onto the view area (view buffer)
-    //! \param color_id_painter A pointer to painter that paints onto the color id buffer
+    //! \return A pointer to the copy
+    //! \sa Leaf::clone()
+    //!
+    std::shared_ptr<Leaf> clone() const override;
+
+    //!
+    //! Draws a leaf instance onto the view area, without any selection outline. The painter's world transformation is expected
+    //! to already be set to the instance's absolute transformation.
+    //!
+    //! \param context The context to draw with; its painter paints onto the view area (view buffer)
     //! \param depth Which consecutive branch the leaf instance is on
     //!
-    void draw(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter, uint depth) override;
+    void draw(RenderContext &context, uint depth) override;
+
+    //!
+    //! Draws the outline of the selected leaf instance, along with its transformation matrix
+    //!
+    //! \param context The context to draw with; its painter paints onto the view area (view buffer)
+    //! \sa Leaf::drawSelection()
+    //!
+    void drawSelection(RenderContext &context) override;
+
+    //!
+    //! Draws a leaf instance onto the color id buffer. The painter's world transformation is expected to already be set to the
+    //! instance's absolute transformation.
+    //!
+    //! \param context The context to draw with; its painter paints onto the color id buffer
+    //! \param color The color that identifies the leaf instance, as assigned by LeafIdentifier
+    //!
+    void drawColorId(RenderContext &context, QColor color) override;
 
     //!
     //! Draws a ghost shape under the cursor when a Drag-and-Drop event is occurring to visualise where exactly the new leaf would be
@@ -54,13 +79,33 @@ public:
 
     inline bool isSpawnPoint() override { return false; }
 
+    //!
+    //! \return A rectangle that contains everything the leaf draws, in the leaf's local space (i.e. without its matrix applied)
+    //!
+    QRectF getBoundingRect() const override;
+
+    //!
+    //! \param view_scale Scale of the view
+    //! \return A rectangle that contains the widened line that is drawn onto the color id buffer, in the leaf's local space
+    //!
+    QRectF getColorIdBoundingRect(qreal view_scale) const override;
+
+    //!
+    //! Checks whether a point hits the leaf
+    //!
+    //! \param point The point, in the leaf's local space
+    //! \param tolerance How far (in local space) from shapes without area (e.g. lines) the point may be and still hit them
+    //! \return Whether the point hits the leaf
+    //!
+    bool contains(QPointF point, qreal tolerance) const override;
+
     QLineF getLine() const { return line_; }
 
-    void setLine(QLineF line) { line_ = line; }
+    void setLine(QLineF line) { line_ = line; markModified(); }
 
     QColor getColor() const { return color_; }
 
-    void setColor(QColor color) { color_ = color; }
+    void setColor(QColor color) { color_ = color; pen_ = QPen(color); markModified(); }
 
 private:
     //!
@@ -68,12 +113,24 @@ private:
     //!
     void createControls() override;
 
+    //!
+    //! \param view_scale Scale of the view
+    //! \return Width (in local space) of the pen that the line is drawn with onto the color id buffer
+    //!
+    qreal getColorIdPenWidth(qreal view_scale) const;
+
     //!  The geometry of each newly created line
     static constexpr QLineF kDefaultLine = QLineF(-10.0f, -10.0f, 10.0f, 10.0f);
 
     QLineF line_;
 
     QColor color_;
+
+    //!  A pen of the color, built once instead of for every drawn instance
+    QPen pen_;
+
+    //!  Pen of the outline of the selected line instance; the line is drawn over it again, so that only its edges show
+    static const QPen kLineSelectionPen;
 };
 
 #endif // LINE_H
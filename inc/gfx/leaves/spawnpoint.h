@@ -32,25 +32,72 @@ public:
     //!
     static std::shared_ptr<SpawnPoint> constructNew(std::weak_ptr<RgfCtx> ctx);
 
+    //!
+    //! Creates a detached copy of the leaf for a snapshot of the tree
+    //!
+    //! \return A pointer to the copy
+    //! \sa Leaf::clone()
+    //!
+    std::shared_ptr<Leaf> clone() const override;
+
     ~SpawnPoint();
 
     //!
-    //! Draws a leaf instance onto the view area and the color id buffer
+    //! Draws a leaf instance onto the view area, without any selection outline. The painter's world transformation is expected
+    //! to already be set to the instance's absolute transformation.
     //!
-    //! \param painter A pointer to the painter that paints onto the view area (view buffer)
-    //! \param color_id_painter A pointer to painter that paints onto the color id buffer
+    //! \param context The context to draw with; its painter paints onto the view area (view buffer)
     //! \param depth Which consecutive branch the leaf instance is on
     //!
-    void draw(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter, uint depth) override;
+    void draw(RenderContext &context, uint depth) override;
+
+    //!
+    //! Draws the outline of the selected leaf instance, along with its transformation matrix
+    //!
+    //! \param context The context to draw with; its painter paints onto the view area (view buffer)
+    //! \sa Leaf::drawSelection()
+    //!
+    void drawSelection(RenderContext &context) override;
+
+    //!
+    //! Draws a leaf instance onto the color id buffer. The painter's world transformation is expected to already be set to the
+    //! instance's absolute transformation.
+    //!
+    //! \param context The context to draw with; its painter paints onto the color id buffer
+    //! \param color The color that identifies the leaf instance, as assigned by LeafIdentifier
+    //!
+    void drawColorId(RenderContext &context, QColor color) override;
 
     inline bool isSpawnPoint() override { return true; }
 
+    //!
+    //! \return A rectangle that contains everything the leaf draws, in the leaf's local space (i.e. without its matrix applied)
+    //!
+    QRectF getBoundingRect() const override;
+
+    //!
+    //! Checks whether a point hits the leaf
+    //!
+    //! \param point The point, in the leaf's local space
+    //! \param tolerance How far (in local space) from shapes without area (e.g. lines) the point may be and still hit them
+    //! \return Whether the point hits the leaf
+    //!
+    bool contains(QPointF point, qreal tolerance) const override;
+
 private:
     //!
     //! Creates controls (widgets in the view area) to modify the leaf
     //!
     void createControls() override;
 
+    //!  Radius of the area around the spawn point that selects it
+    static constexpr qreal kSelectableRadius = 3.0;
+
+    //!  Pen of the editable spawn point instance
+    static const QPen kEditablePen;
+
+    //!  Pen of the spawn point instances that can't be edited
+    static const QPen kSpawnedPen;
 };
 
 #endif // SPAWNPOINT_H
@@ -0,0 +1,81 @@
+// Regrafusion - draws graphics recursively
+// Distributed under GPL-3.0
+// Copyright (C) 2024  Vesko Milev
+
+/*! \file spawn_transformation_table.h */
+
+#ifndef SPAWN_TRANSFORMATION_TABLE_H
+#define SPAWN_TRANSFORMATION_TABLE_H
+
+#include <unordered_map>
+#include <vector>
+#include <QTransform>
+
+//!  A lazily built table of the powers of a spawn transformation and of their inverses, indexed by depth.
+
+//!  Mapping between world space and the space of a branch instance at a given depth takes the spawn transformation applied
+//!  depth times. Instead of multiplying it depth times on every mapping, each power is calculated once, by binary exponentiation
+//!  from the powers of two of the transformation, and kept until the transformation changes.
+//! \sa Tree::getSpawnPointTransformation()
+class SpawnTransformationTable
+{
+public:
+    SpawnTransformationTable();
+
+    //!
+    //! \param spawn_transformation The current spawn transformation; the table is cleared if it has changed
+    //! \param depth How many times the transformation is applied
+    //! \return The spawn transformation applied depth times, i.e. from the space of a branch instance at that depth to the
+    //! space of the root branch
+    //!
+    const QTransform& power(const QTransform &spawn_transformation, uint depth);
+
+    //!
+    //! \param spawn_transformation The current spawn transformation; the table is cleared if it has changed
+    //! \param depth How many times the inverse transformation is applied
+    //! \return The inverse of power(), i.e. from the space of the root branch to the space of a branch instance at that depth
+    //!
+    const QTransform& inversePower(const QTransform &spawn_transformation, uint depth);
+
+private:
+    // disable copy and assignment ctors
+    SpawnTransformationTable(const SpawnTransformationTable&) = delete;
+    SpawnTransformationTable& operator=(const SpawnTransformationTable&) = delete;
+
+    //!  The powers of a single transformation
+    struct Powers
+    {
+        //!  The transformation raised to the powers of two, i.e. squares[i] is the transformation applied 2^i times
+        std::vector<QTransform> squares;
+
+        //!  Already calculated powers, indexed by exponent
+        std::unordered_map<uint, QTransform> powers;
+    };
+
+    //!
+    //! Clears the table if the spawn transformation has changed
+    //!
+    //! \param spawn_transformation The current spawn transformation
+    //!
+    void update(const QTransform &spawn_transformation);
+
+    //!
+    //! Looks up a power, calculating it by binary exponentiation if it isn't known yet
+    //!
+    //! \param powers The powers of the transformation
+    //! \param exponent How many times the transformation is applied
+    //! \return The power
+    //!
+    static const QTransform& lookUp(Powers &powers, uint exponent);
+
+    //!  The spawn transformation that the table has been built for
+    QTransform spawn_transformation_;
+
+    //!  Powers of the spawn transformation
+    Powers powers_;
+
+    //!  Powers of the inverse spawn transformation
+    Powers inverse_powers_;
+};
+
+#endif // SPAWN_TRANSFORMATION_TABLE_H
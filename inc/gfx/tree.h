@@ -7,23 +7,37 @@
 #ifndef TREE_H
 #define TREE_H
 
+#include <chrono>
 #include <vector>
 #include <QtGlobal>
 
 #include "branch.h"
+#include "display_list.h"
+#include "spawn_transformation_table.h"
 #include "leaf_identifier.h"
+#include "sample_buffer.h"
 
 class RgfCtx;
 
-//! Utility struct to record how fast the tree is drawn
+//! Utility struct to record how fast the tree is drawn. It keeps a fixed number of the latest samples of each measurement,
+//! so that tail latencies (e.g. hitches) can be seen, not only averages.
 
 //! \sa Tree
 struct TreeStatistics
 {
-    std::vector<uint> render_time_us;
-    std::vector<uint> first_branch_render_time_us;
-    std::vector<uint> last_branch_render_time_us;
-    std::vector<uint> avg_branch_render_time_us;
+    //!  Maximum sample size of each of the measurements
+    static constexpr size_t kSampleSize = 128;
+
+    //!  Samples of a measurement in microseconds
+    using Samples = SampleBuffer<uint, kSampleSize>;
+
+    Samples render_time_us;
+    Samples first_branch_render_time_us;
+    Samples last_branch_render_time_us;
+    Samples avg_branch_render_time_us;
+    Samples background_render_time_us; //!< time to draw everything below the tree, i.e. the background, the grid and the axes
+    Samples allocations; //!< heap allocations of all threads while the tree was drawn; only counted in debug builds
+    uint effective_depth; //!< how many branch instances deep the last frame actually went
 };
 
 //!  The tree class contains a collection of all branches to be drawn onto the view area.
@@ -40,23 +54,133 @@ public:
     Tree(std::weak_ptr<RgfCtx> ctx, uint num_branches_to_draw);
 
     //!
-    //! Draws all branches onto the view area and the color id buffer
+    //! Draws all branches onto the view area. The tree is first compiled into a display list, using the painter's current world
+    //! transformation as the transformation of the root branches.
     //!
     //! \param painter A pointer to the painter that paints onto the view area (view buffer)
-    //! \param color_id_painter A pointer to painter that paints onto the color id buffer
+    //! \param visible_area The area of the painter's device that is visible; leaf instances outside of it aren't drawn
+    //! \param draw_state Program state that leaf instances are drawn according to
+    //! \param color_id_painter If not null, a pointer to a painter that paints onto the color id buffer. The color id buffer is
+    //! then drawn as well, concurrently with the view area.
     //! \return Statistics about drawing performance
     //!
-    TreeStatistics& draw(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter);
+    TreeStatistics& draw(std::shared_ptr<QPainter> painter, const QRectF &visible_area, const LeafDrawState &draw_state,
+                         std::shared_ptr<QPainter> color_id_painter = nullptr);
+
+    //!
+    //! Starts drawing the tree incrementally, so that a deep tree can be drawn over several frames. The tree is compiled into
+    //! a display list the same way as in draw(), but nothing is drawn yet.
+    //!
+    //! \param painter A pointer to the painter that paints onto the view area (view buffer)
+    //! \param visible_area The area of the painter's device that is visible; leaf instances outside of it aren't drawn
+    //! \param draw_state Program state that leaf instances are drawn according to
+    //! \param drawn_area If not empty, only leaf instances that touch this part of the visible area are drawn, e.g. because the
+    //! rest of it has been drawn already. The painter is expected to be clipped to it. All visible instances are still compiled,
+    //! so that they can be picked.
+    //! \sa drawNext()
+    //!
+    void beginDraw(std::shared_ptr<QPainter> painter, const QRectF &visible_area, const LeafDrawState &draw_state,
+                   const QRegion &drawn_area = QRegion());
+
+    //!
+    //! Continues an incremental draw, drawing leaf instances in z-order until the time budget is used up. Statistics are
+    //! recorded once the whole tree has been drawn. Starting a new draw cancels the one in progress.
+    //!
+    //! \param painter A pointer to the painter that paints onto the view area; its device should contain everything
+    //! drawn by the previous calls
+    //! \param budget How long to draw for
+    //! \return Whether the whole tree has been drawn
+    //! \sa beginDraw()
+    //!
+    bool drawNext(std::shared_ptr<QPainter> painter, std::chrono::nanoseconds budget);
+
+    const TreeStatistics & getStatistics() const { return stats_; }
+
+    //!
+    //! \return How many leaf instances the last drawn frame has, i.e. how many weren't culled
+    //!
+    size_t getNumInstances() const { return display_list_.instances().size(); }
+
+    //!
+    //! Creates a copy of the tree that can be drawn on another thread while the tree itself is being edited. The copy shares
+    //! nothing that can change with the tree; it has clones of all leaves and the tree's settings and statistics.
+    //!
+    //! \return A pointer to the copy
+    //! \sa Branch::clone(), Leaf::clone()
+    //!
+    std::shared_ptr<Tree> snapshot() const;
+
+    //!
+    //! Replaces the statistics, so that the samples of frames drawn from a snapshot can be kept by the tree
+    //!
+    //! \param stats The statistics
+    //!
+    void setStatistics(const TreeStatistics &stats) { stats_ = stats; }
+
+    //!
+    //! Adds a sample of how long it took to draw everything below the tree to the statistics
+    //!
+    //! \param render_time How long it took
+    //! \sa TreeStatistics::background_render_time_us
+    //!
+    void recordBackgroundStatistics(std::chrono::steady_clock::duration render_time);
+
+    //!
+    //! Draws the leaf instances of the last drawn frame onto the color id buffer
+    //!
+    //! \param color_id_painter A pointer to painter that paints onto the color id buffer
+    //! \param leaf_identifier The leaf identifier that assigns colors to the drawn leaf instances
+    //! \param area If valid, only leaf instances that intersect this area of the painter's device are drawn
+    //!
+    void drawColorIds(std::shared_ptr<QPainter> color_id_painter, LeafIdentifier &leaf_identifier, const QRectF &area = QRectF());
+
+    //!
+    //! Identifies the leaf instance of the last drawn frame at a given position
+    //!
+    //! \param position Position on the screen
+    //! \param leaf_depth A reference to the leaf depth, which is filled in (return parameter)
+    //! \return Pointer to the leaf at the position (if any) or nullptr if there is none
+    //!
+    std::shared_ptr<Leaf> getLeaf(QPointF position, uint &leaf_depth);
 
     //!
     //! Sets how many branch instances should be drawn
     //!
     //! \param num_branches How many branch instances should be drawn
     //!
-    void setNumBranches(uint num_branches) { num_branches_to_draw_ = num_branches; }
+    void setNumBranches(uint num_branches);
 
     uint getNumBranches() { return num_branches_to_draw_; }
 
+    //!
+    //! Enables or disables adaptive depth. In adaptive depth mode, branches aren't spawned once they become smaller than the
+    //! adaptive depth threshold, even if fewer than the set number of branch instances have been drawn.
+    //!
+    //! \param enabled Whether adaptive depth should be enabled
+    //!
+    void setAdaptiveDepth(bool enabled);
+
+    bool isAdaptiveDepthEnabled() const { return adaptive_depth_; }
+
+    //!
+    //! Sets the size of the smallest branch instance that is drawn in adaptive depth mode
+    //!
+    //! \param threshold_px The size in pixels
+    //!
+    void setAdaptiveDepthThreshold(qreal threshold_px);
+
+    qreal getAdaptiveDepthThreshold() const { return adaptive_depth_threshold_px_; }
+
+    //!  Default size of the smallest branch instance that is drawn in adaptive depth mode, in pixels
+    static constexpr qreal kDefaultAdaptiveDepthThreshold = 2.0;
+
+    //!
+    //! \return The greatest revision of the tree's settings and branches. It changes whenever anything about the tree that is
+    //! drawn changes, so a frame that has been drawn for the same revision doesn't have to be drawn again.
+    //! \sa nextRevision()
+    //!
+    uint64_t getRevision() const;
+
     //!
     //! Deselects all branches
     //!
@@ -67,6 +191,29 @@ public:
     //!
     QTransform getSpawnPointTransformation();
 
+    //!
+    //! Sets the transformation matrix of the Spawn Point leaf of the only Branch. Trees are created with exactly one branch,
+    //! which is asserted.
+    //!
+    //! \param transformation The new transformation
+    //! \return Whether the setting was successful
+    //!
+    bool setSpawnPointTransformation(QTransform transformation);
+
+    //!
+    //! \param depth How many times the transformation is applied
+    //! \return The transformation of the Spawn Point leaf applied depth times, i.e. from the space of the branch instance at that
+    //! depth to world space. Powers are kept until the transformation changes, so repeated calls are cheap.
+    //!
+    QTransform getSpawnPointTransformation(uint depth);
+
+    //!
+    //! \param depth How many times the inverse transformation is applied
+    //! \return The inverse of getSpawnPointTransformation(depth), i.e. from world space to the space of the branch instance at
+    //! that depth
+    //!
+    QTransform getInverseSpawnPointTransformation(uint depth);
+
     //!
     //! Removes a leaf from all branches
     //!
@@ -85,10 +232,29 @@ public:
     std::shared_ptr<Leaf> createLeaf(leaf_type_t leaf_type, QPointF position, qreal scale);
 
 private:
+    //!
+    //! Creates a tree with the given branches, instead of with a new one
+    //!
+    //! \param ctx A pointer to the context
+    //! \param num_branches_to_draw How many branch instances should be drawn
+    //! \param branches The branches of the tree
+    //!
+    Tree(std::weak_ptr<RgfCtx> ctx, uint num_branches_to_draw, std::vector<std::unique_ptr<Branch>> branches);
+
     // disable copy and assignment ctors
     Tree(const Tree&) = delete;
     Tree& operator=(const Tree&) = delete;
 
+    //!
+    //! Adds the samples of a finished draw to the statistics
+    //!
+    //! \param branch_stats Per depth statistics of the draw
+    //! \param render_time How long the whole draw took
+    //! \param allocations How many heap allocations were made during the draw
+    //!
+    void recordStatistics(const BranchStatistics &branch_stats, std::chrono::steady_clock::duration render_time,
+                          uint64_t allocations);
+
     std::weak_ptr<RgfCtx> ctx_;
 
     //!  A vector containing all branches
@@ -97,11 +263,30 @@ private:
     //!  How many branch instances should be drawn
     uint num_branches_to_draw_;
 
+    //!  Whether small branches should stop the recursion
+    bool adaptive_depth_;
+
+    //!  Size of the smallest branch instance that is drawn in adaptive depth mode, in pixels
+    qreal adaptive_depth_threshold_px_;
+
+    //!  Revision of the last change to the tree's settings
+    uint64_t revision_;
+
+    //!  Powers of the spawn transformation by depth, for mapping between world space and the space of branch instances
+    SpawnTransformationTable spawn_transformations_;
+
+    //!  All leaf instances of the last drawn frame
+    DisplayList display_list_;
+
     //!  Statistics about last drawing performance
     TreeStatistics stats_;
 
-    //!  Maximum sample size of each of the vectors of TreeStatistics
-    static constexpr uint kMaxStatsSampleSize = 20;
+    //!  Time spent on the incremental draw in progress so far
+    std::chrono::steady_clock::duration incremental_render_time_;
+
+    //!  The allocation count when the incremental draw in progress was started
+    //! \sa allocationCount()
+    uint64_t incremental_allocation_count_;
 };
 
 #endif // TREE_H
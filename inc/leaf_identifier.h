@@ -7,24 +7,28 @@
 #ifndef LEAFIDENTIFIER_H
 #define LEAFIDENTIFIER_H
 
-#include <map>
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <vector>
 #include <QColor>
 #include <QImage>
 
 #include "gfx/leaf.h"
 
-//!  A utility struct/function to help sort a std::map with a key of QColor
-struct QColorComparison {
-    bool operator()(const QColor& first, const QColor& second) const {
-        return first.rgb() < second.rgb();
-    }
-};
+class Tree;
 
-//!  A helper class whose task is to assign a unique color to each leaf.
+//!  A helper class whose task is to assign a unique id to each leaf and to identify leaf instances in the color id buffer.
 
-//!  Each leaf uses its unique color to draw itself in the color id buffer. When a mouse click occurs, the color under the cursor
-//!  in the color id buffer is checked and this determines which leaf instance (which leaf at which depth) is selected.
+//!  Leaf ids are 32-bit handles into a slot map: the lower bits are the index of the leaf's slot and the upper bits are the
+//!  generation of the slot, which changes each time the slot is freed. So looking up a leaf is a single array access, and ids of
+//!  deleted leaves are detected even after their slot has been reused. Since the generation would wrap around and give out an
+//!  old id again, a slot that has reached its last generation is retired instead of being freed, so no id is ever reused. Leaf instances aren't drawn in the color id buffer
+//!  using their leaf's id, though. Instead, each pass over the buffer numbers the instances it draws and each instance is drawn
+//!  using a color that encodes its number. The number is then looked up in a table that holds the leaf id and the depth of
+//!  the instance, so neither the number of leaves nor the depth of the tree is limited by the 24 bits of a color.
+//!  When a mouse click occurs, only a few pixels around the cursor are drawn in the color id buffer and the color under the cursor
+//!  determines which leaf instance (which leaf at which depth) is selected.
 class LeafIdentifier
 {
 public:
@@ -33,27 +37,49 @@ public:
     ~LeafIdentifier();
 
     //!
-    //! Assign a unique color to a leaf and mark the color as used
+    //! Assigns a unique id to a leaf and marks the id as used
     //!
-    //! \param leaf A pointer to the leaf to be assigned color to
-    //! \return A unique color that corresponds to the leaf if the operation has been successful, or an invalid color otherwise
+    //! \param leaf A pointer to the leaf to be assigned an id to
+    //! \return A unique id that corresponds to the leaf if the operation has been successful, or kInvalidLeafId otherwise
     //!
-    QColor registerLeaf(std::shared_ptr<Leaf> leaf);
+    uint32_t registerLeaf(std::shared_ptr<Leaf> leaf);
 
     //!
-    //! Unassign a color from a leaf and marked it as unused
+    //! Unassigns the id of a leaf and marks it as unused, so that it can be assigned to another leaf
     //!
-    //! \param leaf A pointer to the leaf to be unassigned color from
+    //! \param leaf A pointer to the leaf to be unassigned its id from
     //!
     void unregisterLeaf(std::shared_ptr<Leaf> leaf);
 
+    //!
+    //! Looks up a leaf by its id
+    //!
+    //! \param leaf_id The id of the leaf
+    //! \return Pointer to the leaf or nullptr if the id isn't assigned to any leaf (anymore)
+    //!
+    std::shared_ptr<Leaf> getLeaf(uint32_t leaf_id) const;
+
+    //!
+    //! Starts a new pass over the color id buffer, i.e. forgets all instances registered by registerInstance()
+    //!
+    void beginPass();
+
+    //!
+    //! Assigns a color to a leaf instance for the current pass over the color id buffer
+    //!
+    //! \param leaf_id The id of the instance's leaf
+    //! \param depth The depth of the instance
+    //! \return The color that the instance should be drawn with, or an invalid color if the pass has run out of colors
+    //!
+    QColor registerInstance(uint32_t leaf_id, uint depth);
+
     //!
     //! A polymorphic of getLeaf() with floating point coordinates
     //!
     std::shared_ptr<Leaf> getLeaf(std::shared_ptr<QImage> color_id_buffer, QPointF position, uint& leaf_depth);
 
     //!
-    //! Identifies the leaf under the cursor
+    //! Identifies the leaf under the cursor, as drawn by the last pass over the color id buffer
     //!
     //! \param color_id_buffer Pointer to the color id buffer
     //! \param position Position of the cursor on the screen
@@ -62,35 +88,85 @@ public:
     //!
     std::shared_ptr<Leaf> getLeaf(std::shared_ptr<QImage> color_id_buffer, QPoint position, uint& leaf_depth);
 
+    //!
+    //! Draws the color id buffer in a small area around a position and identifies the leaf there. Leaf instances outside that
+    //! area aren't drawn at all, so this is much cheaper than drawing the whole buffer.
+    //!
+    //! \param tree Pointer to the tree, whose last drawn frame is used
+    //! \param color_id_buffer Pointer to the color id buffer
+    //! \param view_transform Transformation from world space to view space
+    //! \param position Position of the cursor on the screen
+    //! \param leaf_depth A reference to the leaf depth, which is filled in (return parameter)
+    //! \return Pointer to the leaf under the cursor (if any) or nullptr if there is none
+    //!
+    std::shared_ptr<Leaf> pick(std::shared_ptr<Tree> tree, std::shared_ptr<QImage> color_id_buffer, const QTransform &view_transform,
+                               QPointF position, uint& leaf_depth);
+
     QColor getBackgroundColor() const { return kBackgroundColor; }
 
+    //!  An id that is never assigned to a leaf
+    static constexpr uint32_t kInvalidLeafId = UINT32_MAX;
+
 private:
-    //!
-    //! Progresses the internal color indicator to the next unused color
-    //!
-    void goToNextColor();
+    //!  A leaf instance drawn during the current pass over the color id buffer
+    struct InstanceId
+    {
+        uint32_t leaf_id;
+        uint depth;
+    };
+
+    //!  A slot of the slot map of leaves
+    struct Slot
+    {
+        //!  The leaf that uses the slot, or nullptr if the slot is free
+        std::shared_ptr<Leaf> leaf;
+
+        //!  Incremented each time the slot is freed, so that ids assigned before that don't match it anymore. It never wraps
+        //!  around: the slot is retired once it reaches kGenerationMask.
+        uint32_t generation;
+    };
+
+    //!  All slots ever used, indexed by the lower bits of leaf ids
+    std::vector<Slot> slots_;
+
+    //!  Indices of free slots, which are reused before new ones are added. They're reused in the order they were freed, so that
+    //!  the generations of all slots advance evenly instead of a single slot being freed and reused over and over.
+    std::deque<uint32_t> free_slots_;
+
+    //!  Out of the 32 bits of a leaf id, the lower 24 bits are for the slot index
+    static constexpr uint32_t kSlotIndexBits = 24;
+
+    static constexpr uint32_t kSlotIndexMask = (1u << kSlotIndexBits) - 1;
+
+    //!  The upper 8 bits of a leaf id are for the slot generation
+    static constexpr uint32_t kGenerationMask = 0xFF;
+
+    //!  The last slot index is never used, so that no id equals kInvalidLeafId
+    static constexpr size_t kMaxNumSlots = kSlotIndexMask;
+
+    //!  Instances drawn during the current pass, indexed by their number in the pass
+    std::vector<InstanceId> pass_instances_;
 
-    //!  A map of all used up colors along with the leaves they respectively identify
-    std::map<QColor, std::shared_ptr<Leaf>, QColorComparison> leaf_map_;
+    //!  Color 0 is the background, so instance numbers start from 1
+    static constexpr QColor kBackgroundColor = QColor(0, 0, 0, 255);
 
-    //!  An identicator of the next color to be used as identifier
-    QColor next_unused_color_;
+    //!  Out of 32 bits per pixel, only the 24 rgb bits hold information
+    static constexpr uint32_t kColorMask = 0xFFFFFF;
 
-    static constexpr QColor kBackgroundColor = QColor(255, 255, 255, 255);
+    //!  Maximum number of instances in a single pass, as all colors other than the background can be used
+    static constexpr size_t kMaxNumInstances = kColorMask;
 
-    //!  The first color to be used as identifier
-    static constexpr QColor kInitialColor = QColor(0, 0, 0, 255);
+    //!  An odd number that consecutive instance numbers are multiplied by, so that neighbouring instances get distinct colors
+    //! when the color id buffer is shown. Since it's odd, the multiplication can be undone modulo 2^24.
+    static constexpr uint32_t kColorScrambler = 0x9E3779;
 
-    //!  Number of colors other than white, which is the background
-    static constexpr size_t kMaxNumLeaves = 256 * 256 * 256 - 1;
+    //!  The multiplicative inverse of kColorScrambler modulo 2^24, which undoes the multiplication
+    static constexpr uint32_t kColorUnscrambler = 0xB382C9;
 
-    //!  Out of 3 x 8 = 24 rgb bits, the first 14 bits are for the leaf
-    static constexpr size_t kLeafMask = 0xFFFC00;
+    static_assert(((kColorScrambler * kColorUnscrambler) & kColorMask) == 1, "The color unscrambler has to be the inverse of the scrambler");
 
-    //!  Out of 3 x 8 = 24 rgb bits, the last 10 bits are for the branch depth
-    //! It is necessary to pass around information about depth, since it is needed to calculate branch transformations for the purposes of e.g. dragging a shape around
-    //! Total branch transformation is the depth times the spawn point transformation
-    static constexpr size_t kDepthMask = 0x3FF;
+    //!  How many pixels around the cursor are drawn by pick()
+    static constexpr int kPickRadius = 2;
 };
 
 #endif // LEAFIDENTIFIER_H
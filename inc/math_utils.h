@@ -9,6 +9,7 @@
 #ifndef MATH_UTILS_H
 #define MATH_UTILS_H
 
+#include <vector>
 #include <QPoint>
 #include <QPointF>
 #include <QTransform>
@@ -31,6 +32,43 @@ struct TransformationInfo {
 //!
 TransformationInfo decomposeMatrix(QTransform matrix);
 
+//!
+//! Calculates the largest factor by which a matrix can stretch a vector, i.e. the largest singular value of its linear part.
+//! A matrix whose maximum scale is less than 1 is a contraction.
+//!
+//! \param matrix The matrix
+//! \return The maximum scale
+//!
+qreal getMaxScale(const QTransform &matrix);
+
+//!
+//! Calculates the point that a matrix maps onto itself
+//!
+//! \param matrix The matrix
+//! \param fixed_point A reference to the fixed point, which is filled in (return parameter)
+//! \return Whether the matrix has a single fixed point
+//!
+bool getFixedPoint(const QTransform &matrix, QPointF &fixed_point);
+
+//!
+//! Calculates the distance between a point and a line segment
+//!
+//! \param point The point
+//! \param segment_start The first end of the segment
+//! \param segment_end The second end of the segment
+//! \return The distance between them
+//!
+qreal getPointToSegmentDistance(QPointF point, QPointF segment_start, QPointF segment_end);
+
+//!
+//! Checks whether a point is inside of a polygon using the even-odd rule, i.e. the same way QPainterPath is filled by default
+//!
+//! \param point The point
+//! \param polygon The vertices of the polygon. The polygon is implicitly closed.
+//! \return Whether the point is inside
+//!
+bool isPointInPolygon(QPointF point, const std::vector<QPointF> &polygon);
+
 // todo: maybe move this to a test framework
 //!
 //! Testing function
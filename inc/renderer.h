@@ -0,0 +1,214 @@
+// Regrafusion - draws graphics recursively
+// Distributed under GPL-3.0
+// Copyright (C) 2024  Vesko Milev
+
+/*! \file renderer.h */
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <QImage>
+#include <QMutex>
+#include <QPainter>
+#include <QRegion>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "gfx/tree.h"
+#include "view.h"
+
+//!  Everything that is needed to draw a frame. None of it is shared with the GUI thread, so it can't change while it's drawn.
+
+//! \sa Renderer
+struct FrameRequest
+{
+    //!  A snapshot of the tree
+    std::shared_ptr<Tree> tree;
+
+    //!  The view the frame is drawn for
+    View view;
+
+    //!  Program state that leaf instances are drawn according to
+    LeafDrawState draw_state;
+
+    //!  Revision of the tree the snapshot has been taken of
+    uint64_t revision;
+
+    //!
+    //! \param other Another request
+    //! \return Whether both requests are for the same frame, i.e. for the same revision of the tree, the same view and program state
+    //!
+    bool drawsSameFrame(const FrameRequest &other) const
+    {
+        return revision == other.revision && view == other.view && draw_state == other.draw_state;
+    }
+};
+
+//!  A frame drawn by the renderer, i.e. everything in the view area below the overlays
+
+//! \sa Renderer
+struct Frame
+{
+    //!  The drawn frame, as large as the view area
+    QImage image;
+
+    //!  The request the frame was drawn for. Its tree keeps the display list of the frame, so that leaves can be picked from it.
+    FrameRequest request;
+
+    //!  Statistics about how fast the frame was drawn
+    TreeStatistics stats;
+
+    //!  Whether the whole tree has been drawn, rather than the part of it that fit in the frame budget
+    bool complete;
+};
+
+//!  Draws frames on a dedicated render thread, so that the GUI thread stays responsive while a frame is being drawn.
+
+//!  Only the latest request is kept; a request that is submitted before the previous one has been started replaces it,
+//!  and one that is submitted while a frame is being drawn progressively cancels the rest of it.
+//!  When the view has only been panned since the last finished frame, that frame is shifted and only the newly exposed strips
+//!  are drawn.
+//!  Frames are triple buffered: one is displayed, one is ready to be displayed and one is being drawn. A ready frame that
+//!  hasn't been displayed by the time the next one is finished is dropped.
+//!  Tree snapshots are created on the GUI thread and their leaves are QObjects, which may only be deleted by the thread they
+//!  belong to. So the render thread never releases a snapshot itself, but hands it back to the GUI thread instead.
+class Renderer : public QThread
+{
+    Q_OBJECT
+
+public:
+    Renderer(QObject *parent = nullptr);
+
+    ~Renderer();
+
+    //!
+    //! Requests a frame to be drawn, starting the render thread if it isn't running yet
+    //!
+    //! \param request The request; replaces any request that hasn't been started yet
+    //!
+    void submit(FrameRequest request);
+
+    //!
+    //! Exchanges the displayed frame for the newest finished one, if there is one
+    //!
+    //! \param displayed_frame The currently displayed frame, if any. It's reused for drawing if a newer frame is returned.
+    //! \return The newest finished frame, or displayed_frame if no frame has been finished since the last call. Also destroys
+    //! the snapshots that the render thread has released since the last call.
+    //!
+    std::shared_ptr<Frame> swapFrame(std::shared_ptr<Frame> displayed_frame);
+
+    //!
+    //! Draws everything below the overlays: the background, the grid (unless in view mode) and the tree
+    //!
+    //! \param painter A pointer to the painter that paints onto the view area
+    //! \param request The request to draw
+    //! \param color_id_painter If not null, a pointer to a painter that paints onto the color id buffer, which is drawn as well
+    //! \return Statistics about drawing performance
+    //!
+    static TreeStatistics drawScene(std::shared_ptr<QPainter> painter, const FrameRequest &request,
+                                    std::shared_ptr<QPainter> color_id_painter = nullptr);
+
+    //!
+    //! Draws a whole frame onto a new image right away, without the render thread, e.g. to export it or to measure how fast it's
+    //! drawn. Doesn't need a window, so it works under the offscreen platform plugin as well.
+    //!
+    //! \param request The request to draw; the view's size is the size of the image
+    //! \return The drawn frame
+    //!
+    static Frame drawFrame(const FrameRequest &request);
+
+    //!
+    //! Draws everything below the tree: the background and the grid (unless in view mode). Leaves the painter's world
+    //! transformation set to the view transformation. Everything is anchored to world space, so that frames can be shifted
+    //! while the view is panned; elements at fixed positions of the view area, such as rulers, are overlays instead.
+    //!
+    //! \param painter A pointer to the painter that paints onto the view area
+    //! \param request The request to draw
+    //!
+    static void drawBackground(std::shared_ptr<QPainter> painter, const FrameRequest &request);
+
+    //!  How long the render thread draws before it displays what it has drawn so far, so that deep trees appear progressively
+    static constexpr std::chrono::milliseconds kFrameBudget = std::chrono::milliseconds(8);
+
+    //!  How far (in pixels) a panned view's offset may be from a whole number of pixels and the last frame still be shifted
+    static constexpr qreal kMaxScrollError = 0.01;
+
+signals:
+    //!
+    //! Emitted from the render thread whenever a frame is finished
+    //!
+    void frameReady();
+
+protected:
+    //!
+    //! Main loop of the render thread; draws the latest request until the renderer is destroyed. Frames are drawn incrementally:
+    //! once the frame budget has been used up, the partly drawn frame is published and its copy is drawn further, unless a new
+    //! request has been submitted meanwhile, which cancels the draw.
+    //!
+    void run() override;
+
+private:
+    // disable copy and assignment ctors
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    //!
+    //! Takes a frame from the free frames, or allocates a new one. A reused frame's snapshot is released. Expects the mutex to
+    //! be locked.
+    //!
+    //! \return A pointer to the frame
+    //!
+    std::shared_ptr<Frame> takeFreeFrame();
+
+    //!
+    //! Copies the last finished frame onto a frame, shifted by how far the view has been panned since, if nothing else has changed.
+    //! Expects the frame's image to be allocated already.
+    //!
+    //! \param frame The frame to copy onto
+    //! \param request The request the frame is drawn for
+    //! \return The area of the frame that still has to be drawn; all of it if the last frame can't be reused, and none of it if
+    //! the view hasn't moved
+    //!
+    QRegion scrollLastFrame(Frame &frame, const FrameRequest &request) const;
+
+    //!
+    //! Hands a tree snapshot over to the GUI thread, which destroys it (unless it's still referred to) on the next swapFrame().
+    //! Expects the mutex to be locked.
+    //!
+    //! \param tree A pointer to the snapshot; may be null
+    //!
+    void releaseTree(std::shared_ptr<Tree> tree);
+
+    //!  The last frame that has been drawn completely, which panned frames are shifted from. It's only written by the render
+    //!  thread and never drawn onto, so it can be read while it's displayed.
+    std::shared_ptr<Frame> last_finished_frame_;
+
+    //!  Guards all members below
+    QMutex mutex_;
+
+    //!  Signalled when a request is submitted or the thread should quit
+    QWaitCondition request_submitted_;
+
+    //!  The latest request that hasn't been started yet
+    FrameRequest pending_request_;
+
+    //!  Whether pending_request_ is valid
+    bool has_pending_request_;
+
+    //!  The newest finished frame that hasn't been displayed yet, if any
+    std::shared_ptr<Frame> ready_frame_;
+
+    //!  Frames that are neither displayed, ready nor being drawn
+    std::vector<std::shared_ptr<Frame>> free_frames_;
+
+    //!  Snapshots that the render thread doesn't need anymore, which are destroyed on the GUI thread
+    std::vector<std::shared_ptr<Tree>> released_trees_;
+
+    //!  Whether the render thread should quit
+    bool quit_;
+};
+
+#endif // RENDERER_H
@@ -25,6 +25,14 @@ public:
     //!
     static std::shared_ptr<RgfCtx> create(DisplayWidget *display_widget, QStatusBar* status_bar);
 
+    //!
+    //! Creates a context without a window, e.g. for rendering trees offscreen. It has neither a DisplayWidget nor a status bar,
+    //! so it doesn't need a screen; refreshes and status messages are ignored.
+    //!
+    //! \return A shared pointer to the context
+    //!
+    static std::shared_ptr<RgfCtx> createHeadless();
+
     ~RgfCtx();
 
     //!
@@ -34,6 +42,20 @@ public:
     //!
     void setNumBranches(uint num_branches);
 
+    //!
+    //! Enables or disables adaptive depth, i.e. whether the Tree stops spawning branches once they become too small to be seen
+    //!
+    //! \param enabled Whether adaptive depth should be enabled
+    //!
+    void setAdaptiveDepth(bool enabled);
+
+    //!
+    //! Sets the size of the smallest branch instance that is drawn in adaptive depth mode
+    //!
+    //! \param threshold_px The size in pixels
+    //!
+    void setAdaptiveDepthThreshold(qreal threshold_px);
+
     const std::shared_ptr<LeafIdentifier> & leafIdentifier() const { return leaf_identifier_; }
 
     const std::shared_ptr<Tree> & tree() const { return tree_; }
@@ -42,10 +64,9 @@ public:
 
     const std::shared_ptr<QImage> & colorIdBuffer() const { return color_id_buffer_; }
 
-    //!  Mode of the program - in view and navigation modes maximum frame rate is greater since the color id buffer isn't drawn
-    //! and some events aren't processed, but the tree cannot be edited.
-    //! In navigation mode grid and rulers are drawn, whereas in view mode only the tree is drawn.
-    enum class mode_t {navigation, edit, view};
+    //!  Mode of the program; it's declared outside of the context, so that leaves can be drawn without it
+    //! \sa ctx_mode_t
+    using mode_t = ctx_mode_t;
 
     const mode_t& getMode() const { return mode_; }
 
@@ -71,6 +92,13 @@ public:
 
     QTransform getSpawnPointTransformation() const { return tree_->getSpawnPointTransformation(); }
 
+    //!
+    //! \param depth How many times the transformation is applied
+    //! \return The transformation of the Spawn Point leaf applied depth times
+    //! \sa Tree::getSpawnPointTransformation()
+    //!
+    QTransform getSpawnPointTransformation(uint depth) const { return tree_->getSpawnPointTransformation(depth); }
+
     //!
     //! Handler of the delete QAction. Deletes the currently selected leaf
     //!
@@ -102,14 +130,22 @@ public:
     //!
     void createLeaf(leaf_type_t leaf_type);
 
-    View getView() const { return display_widget_->getView(); }
+    //!
+    //! \return The view of the DisplayWidget, or a default view if the context is headless
+    //!
+    View getView() const;
 
     //!
     //! Redraws the view area
     //!
     void refresh();
 
-    void setStatusBarMessage(const QString& message) { status_bar_->showMessage(message); }
+    //!
+    //! Shows a message in the status bar, if there is one
+    //!
+    //! \param message The message
+    //!
+    void setStatusBarMessage(const QString& message);
 
 signals:
     void modeSwitched();
@@ -117,7 +153,12 @@ signals:
     void leafSelected(std::shared_ptr<Leaf> leaf, uint leaf_depth);
 
 private:
-    RgfCtx(DisplayWidget *display_widget, QStatusBar* status_bar);
+    //!
+    //! \param display_widget Pointer to the DisplayWidget, or nullptr if the context is headless
+    //! \param status_bar Pointer to the status bar of the window, or nullptr if the context is headless
+    //! \param buffer_size Size of the user view and color id buffers
+    //!
+    RgfCtx(DisplayWidget *display_widget, QStatusBar* status_bar, QSize buffer_size);
 
     //!
     //! Deletes a leaf
@@ -126,8 +167,13 @@ private:
     //!
     void deleteLeaf(std::shared_ptr<Leaf> leaf);
 
+    //!
+    //! Redraws the view area and updates the status bar
+    //!
+    void refreshWithStatus();
+
     // TODO: figure out a way to replate these with shared pointers
-    // as long as the widgets aren't destroyed in run-time (which they aren't) these pointers should never be null
+    // as long as the widgets aren't destroyed in run-time (which they aren't) these pointers are only ever null in headless contexts
     DisplayWidget *display_widget_;
 
     QStatusBar* status_bar_;
@@ -139,7 +185,8 @@ private:
     //!  The buffer to be drawn to the OpenGL canvas that the user sees
     std::shared_ptr<QImage> user_view_buffer_;
 
-    //!  A buffer containing leaf instances drawn with their respective color ids, used for leaf selection purposes
+    //!  A buffer containing leaf instances drawn with their respective color ids, used for leaf selection purposes.
+    //! It's drawn only around the cursor on mouse clicks, or as a whole when it's shown for debugging purposes.
     std::shared_ptr<QImage> color_id_buffer_;
 
     mode_t mode_;
@@ -147,9 +194,6 @@ private:
     std::shared_ptr<Leaf> selected_leaf_;
 
     uint selected_leaf_depth_;
-
-    //!  Branch transformation of the selected leaf applied leaf_depth times
-    QTransform cumulative_branch_transformations_;
 };
 
 #endif // RGFCTX_H
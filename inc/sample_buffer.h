@@ -0,0 +1,104 @@
+// Regrafusion - draws graphics recursively
+// Distributed under GPL-3.0
+// Copyright (C) 2024  Vesko Milev
+
+/*! \file sample_buffer.h */
+
+#ifndef SAMPLE_BUFFER_H
+#define SAMPLE_BUFFER_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+//!  A fixed-capacity ring buffer of the latest samples of a measurement, e.g. of how long frames take to draw.
+
+//!  Adding a sample never allocates and only overwrites the oldest one once the buffer is full. The sum of the samples is kept
+//!  up to date as they're added, so the mean is cheap; percentiles are only calculated when they're asked for.
+//! \sa TreeStatistics
+template<class T, size_t Capacity>
+class SampleBuffer
+{
+public:
+    SampleBuffer() :
+        samples_(),
+        size_(0),
+        next_(0),
+        sum_(0)
+    {
+    }
+
+    //!
+    //! Adds a sample, replacing the oldest one if the buffer is full
+    //!
+    //! \param sample The sample
+    //!
+    void push(T sample)
+    {
+        if (size_ == Capacity) {
+            sum_ -= samples_[next_];
+        } else {
+            size_++;
+        }
+
+        samples_[next_] = sample;
+        sum_ += sample;
+        next_ = (next_ + 1) % Capacity;
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    //!
+    //! \return The latest sample, or 0 if there are none
+    //!
+    T last() const { return empty() ? 0 : samples_[(next_ + Capacity - 1) % Capacity]; }
+
+    //!
+    //! \return The average of all samples, or 0 if there are none
+    //!
+    T mean() const { return empty() ? 0 : static_cast<T>(sum_ / size_); }
+
+    //!
+    //! \param percent Which percentile to calculate, from 0 to 100
+    //! \return The smallest sample that at least the given percentage of samples are less than or equal to (i.e. by the
+    //! nearest-rank method), or 0 if there are none
+    //!
+    T percentile(double percent) const
+    {
+        if (empty()) {
+            return 0;
+        }
+
+        // the order of the samples in the buffer doesn't matter here, since only the first size_ of them are valid
+        std::array<T, Capacity> sorted = samples_;
+        size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * size_));
+        size_t index = std::clamp<size_t>(rank, 1, size_) - 1;
+
+        std::nth_element(sorted.begin(), sorted.begin() + index, sorted.begin() + size_);
+        return sorted[index];
+    }
+
+    //!
+    //! \return The greatest sample, or 0 if there are none
+    //!
+    T max() const { return empty() ? 0 : *std::max_element(samples_.begin(), samples_.begin() + size_); }
+
+private:
+    //!  The samples; once the buffer is full, next_ points at the oldest one
+    std::array<T, Capacity> samples_;
+
+    //!  Number of valid samples
+    size_t size_;
+
+    //!  Index that the next sample is written to
+    size_t next_;
+
+    //!  Sum of all valid samples
+    uint64_t sum_;
+};
+
+#endif // SAMPLE_BUFFER_H
@@ -0,0 +1,245 @@
+// Regrafusion - draws graphics recursively
+// Distributed under GPL-3.0
+// Copyright (C) 2024  Vesko Milev
+
+/*! \file trace.h */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <QMutex>
+#include <QString>
+
+//!  A named integer attached to a trace event, e.g. the depth of a drawn leaf instance. Unused if its name is null.
+struct TraceArg
+{
+    const char *name;
+    int64_t value;
+};
+
+//!  A zone of time recorded by the tracer. Names, categories and argument names have to be string literals, so that recording
+//!  an event never copies strings.
+
+//! \sa Tracer
+struct TraceEvent
+{
+    const char *name;
+    const char *category;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration duration;
+    TraceArg args[2];
+};
+
+//!  Records zones of time of the drawing phases and writes them as Chrome trace-event JSON, which trace viewers (e.g.
+//!  chrome://tracing or Perfetto) can open.
+
+//!  Tracing is opt-in: nothing is recorded until start() is called, and while it's stopped, zones cost a single atomic load.
+//!  Zones can be recorded from any thread. Each thread records into a buffer of its own, so that threads that draw in parallel
+//!  don't wait for each other; the buffers are merged when recording is stopped.
+//! \sa TraceZone, TraceRun
+class Tracer
+{
+public:
+    //!
+    //! \return The tracer of the program
+    //!
+    static Tracer& instance();
+
+    //!
+    //! Starts recording, discarding any previously recorded events
+    //!
+    //! \param path Path of the file that the events are written to when recording is stopped
+    //!
+    void start(const QString &path);
+
+    //!
+    //! Stops recording and writes the recorded events to the file given to start()
+    //!
+    //! \return Whether the file has been written; false if recording hasn't been started or the file couldn't be written
+    //!
+    bool stop();
+
+    //!
+    //! \return Whether events are being recorded
+    //!
+    static bool isEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    //!
+    //! Records a zone, unless recording is stopped or the maximum number of events has been reached
+    //!
+    //! \param name Name of the zone
+    //! \param category Category of the zone, e.g. which part of the program it belongs to
+    //! \param start When the zone started
+    //! \param end When the zone ended
+    //! \param arg An optional argument of the zone
+    //! \param arg2 Another optional argument of the zone
+    //!
+    void record(const char *name, const char *category, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end, TraceArg arg = {nullptr, 0}, TraceArg arg2 = {nullptr, 0});
+
+    //!  Maximum number of events that are recorded, so that a long session doesn't use up all memory; later events are dropped
+    static constexpr size_t kMaxEvents = 2'000'000;
+
+private:
+    Tracer();
+
+    // disable copy and assignment ctors
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    //!  The events recorded by a single thread
+    struct ThreadBuffer
+    {
+        //!  Only ever contended by start() and stop(), since a single thread records into the buffer
+        QMutex mutex;
+
+        std::vector<TraceEvent> events;
+    };
+
+    //!
+    //! \return The buffer of the calling thread; it's created and registered when the thread first records an event
+    //!
+    ThreadBuffer& threadBuffer();
+
+    //!  Whether events are being recorded; checked without locking the mutex, so that disabled zones are cheap
+    static std::atomic<bool> enabled_;
+
+    //!  Guards all members below, except the contents of the buffers and the counters
+    QMutex mutex_;
+
+    //!  Path of the file that the events are written to
+    QString path_;
+
+    //!  When recording started; event timestamps are relative to it
+    std::chrono::steady_clock::time_point start_time_;
+
+    //!  Buffers of all threads that have recorded events, in the order they were registered. They're shared with the threads,
+    //! so that the events of threads that have finished since (e.g. expired thread pool threads) aren't lost.
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+
+    //!  How many events have been recorded by all threads
+    std::atomic<size_t> num_events_;
+
+    //!  How many events have been dropped because there were too many
+    std::atomic<size_t> num_dropped_events_;
+};
+
+//!  Records a zone from its construction until its destruction, if the tracer is recording
+
+//! \sa Tracer
+class TraceZone
+{
+public:
+    //!
+    //! \param name Name of the zone
+    //! \param category Category of the zone
+    //! \param arg An optional argument of the zone
+    //!
+    TraceZone(const char *name, const char *category, TraceArg arg = {nullptr, 0}) :
+        name_(name),
+        category_(category),
+        arg_(arg),
+        enabled_(Tracer::isEnabled())
+    {
+        if (enabled_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~TraceZone()
+    {
+        if (enabled_) {
+            Tracer::instance().record(name_, category_, start_, std::chrono::steady_clock::now(), arg_);
+        }
+    }
+
+private:
+    // disable copy and assignment ctors
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+    const char *name_;
+    const char *category_;
+    TraceArg arg_;
+    bool enabled_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+//!  Records a zone for each run of consecutive steps with the same value, e.g. for each depth of leaf instances that are drawn
+//!  one after another. The last run ends when the object is destroyed.
+
+//! \sa Tracer
+class TraceRun
+{
+public:
+    //!
+    //! \param name Name of the zones
+    //! \param category Category of the zones
+    //! \param arg_name Name of the argument that holds the value of a zone's run
+    //!
+    TraceRun(const char *name, const char *category, const char *arg_name) :
+        name_(name),
+        category_(category),
+        arg_name_(arg_name),
+        enabled_(Tracer::isEnabled()),
+        open_(false),
+        value_(0)
+    {
+    }
+
+    ~TraceRun() { close(); }
+
+    //!
+    //! Starts a new zone if the value differs from the one of the current zone, ending the current one
+    //!
+    //! \param value The value of the next step
+    //!
+    void step(int64_t value)
+    {
+        if (!enabled_ || (open_ && value == value_)) {
+            return;
+        }
+
+        close();
+
+        value_ = value;
+        start_ = std::chrono::steady_clock::now();
+        open_ = true;
+    }
+
+private:
+    // disable copy and assignment ctors
+    TraceRun(const TraceRun&) = delete;
+    TraceRun& operator=(const TraceRun&) = delete;
+
+    //!
+    //! Ends the current zone, if there is one
+    //!
+    void close()
+    {
+        if (open_) {
+            Tracer::instance().record(name_, category_, start_, std::chrono::steady_clock::now(), {arg_name_, value_});
+            open_ = false;
+        }
+    }
+
+    const char *name_;
+    const char *category_;
+    const char *arg_name_;
+    bool enabled_;
+
+    //!  Whether a zone has been started and not ended yet
+    bool open_;
+
+    //!  Value of the current zone
+    int64_t value_;
+
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif // TRACE_H
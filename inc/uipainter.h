@@ -33,11 +33,12 @@ public:
     void drawRulerNumbers();
 
     //!
-    //! Draws statistics about how fast the tree was drawn
+    //! Draws statistics about how fast the tree and the rest of the view area were drawn
     //!
     //! \param stats A reference to the tree statistics
+    //! \param paint_stats A reference to the statistics of the phases of DisplayWidget::paintGL()
     //!
-    void drawStats(TreeStatistics& stats);
+    void drawStats(const TreeStatistics& stats, const PaintStatistics& paint_stats);
 
     //!
     //! Draws a label indicating which mode the context is in
@@ -8,6 +8,7 @@
 #define VIEW_H
 
 #include <QPointF>
+#include <QTransform>
 
 //!  A class representing the current position of the viewport within the world space, i.e. the relation between world space and view space
 struct View
@@ -21,6 +22,27 @@ struct View
     //!  Scaling of the view space
     float scale;
 
+    //!
+    //! \return The transformation from world space to view space
+    //!
+    QTransform transform() const { return QTransform(scale, 0, 0, scale, offset.x(), offset.y()); }
+
+    //!
+    //! \param other Another view
+    //! \return The transformation from this view's space to the other view's space, e.g. to show a frame drawn for this view
+    //! in the other one
+    //!
+    QTransform transformTo(const View &other) const
+    {
+        qreal scale_factor = other.scale / scale;
+        return QTransform(scale_factor, 0, 0, scale_factor, other.offset.x() - offset.x() * scale_factor,
+                          other.offset.y() - offset.y() * scale_factor);
+    }
+
+    bool operator==(const View &other) const { return size == other.size && offset == other.offset && scale == other.scale; }
+
+    bool operator!=(const View &other) const { return !(*this == other); }
+
     //!  Origin point of the space (translation identity)
     static constexpr QPointF kOffsetIdentity = QPointF(0.0f, 0.0f);
 
@@ -53,6 +53,10 @@ private slots:
 
     void on_num_branches_spin_box_valueChanged(int arg1);
 
+    void on_adaptive_depth_check_box_toggled(bool checked);
+
+    void on_adaptive_depth_spin_box_valueChanged(double arg1);
+
     void on_switch_buffers_pressed();
 
     //!
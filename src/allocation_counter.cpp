@@ -0,0 +1,68 @@
+// Regrafusion - draws graphics recursively
+// Distributed under GPL-3.0
+// Copyright (C) 2024  Vesko Milev
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "allocation_counter.h"
+
+#ifdef QT_DEBUG
+
+static std::atomic<uint64_t> allocation_count = 0;
+
+// the replaced operators have to live in the same translation unit as allocationCount(), so that the linker pulls them in
+// from the static library; the nothrow and array forms of new call these by default
+
+void * operator new(std::size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+    // operator new has to return a unique pointer even for zero sizes
+    void *pointer = std::malloc(size > 0 ? size : 1);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return pointer;
+}
+
+void * operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+uint64_t allocationCount()
+{
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+#else
+
+uint64_t allocationCount()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,305 @@
+// Regrafusion - draws graphics recursively
+// Distributed under GPL-3.0
+// Copyright (C) 2024  Vesko Milev
+
+// A rendering benchmark that generates synthetic trees and measures how fast they're drawn offscreen. The scenes are fixed,
+// so that the results of different builds can be compared with each other. Results are written as JSON.
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <vector>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include "allocation_counter.h"
+#include "common.h"
+#include "renderer.h"
+#include "rgf_ctx.h"
+#include "trace.h"
+
+//!  Parameters of a synthetic scene
+struct SceneParams
+{
+    //!  A name that identifies the scene in the results
+    QString name;
+
+    //!  How many leaves the branch has, besides the spawn point
+    uint num_leaves;
+
+    //!  Types of the leaves, which are assigned to them in turn
+    std::vector<leaf_type_t> leaf_types;
+
+    //!  How many branch instances should be drawn
+    uint depth;
+
+    //!  Scaling of the spawn transformation
+    qreal spawn_scale;
+
+    //!  Scale of the view
+    float view_scale;
+};
+
+//!  Radius of the circle that the leaves of a scene's branch are placed on, in world space
+static constexpr qreal kLeafCircleRadius = 40.0;
+
+//!  Scale of the leaves of a scene's branch
+static constexpr qreal kLeafScale = 0.5;
+
+//!
+//! \return The scenes of the benchmark. Each one varies a single parameter of the first one, so that its effect can be seen.
+//!
+static std::vector<SceneParams> benchmarkScenes()
+{
+    const std::vector<leaf_type_t> all_types = {leaf_type_t::circle, leaf_type_t::line, leaf_type_t::rectangle, leaf_type_t::path};
+    const SceneParams base = {"base", 8, all_types, 100, 0.98, 1.0f};
+
+    std::vector<SceneParams> scenes = {base};
+
+    auto vary = [&scenes, &base](const QString &name, auto setter) {
+        SceneParams scene = base;
+        scene.name = name;
+        setter(scene);
+        scenes.push_back(scene);
+    };
+
+    vary("leaves_1", [](SceneParams &scene) { scene.num_leaves = 1; });
+    vary("leaves_32", [](SceneParams &scene) { scene.num_leaves = 32; });
+    vary("leaves_128", [](SceneParams &scene) { scene.num_leaves = 128; });
+    vary("circles", [](SceneParams &scene) { scene.leaf_types = {leaf_type_t::circle}; });
+    vary("lines", [](SceneParams &scene) { scene.leaf_types = {leaf_type_t::line}; });
+    vary("rectangles", [](SceneParams &scene) { scene.leaf_types = {leaf_type_t::rectangle}; });
+    vary("paths", [](SceneParams &scene) { scene.leaf_types = {leaf_type_t::path}; });
+    vary("depth_25", [](SceneParams &scene) { scene.depth = 25; });
+    vary("depth_400", [](SceneParams &scene) { scene.depth = 400; });
+    vary("depth_1000", [](SceneParams &scene) { scene.depth = 1000; });
+    vary("spawn_scale_0.9", [](SceneParams &scene) { scene.spawn_scale = 0.9; });
+    vary("spawn_scale_0.995", [](SceneParams &scene) { scene.spawn_scale = 0.995; });
+    vary("zoom_0.2", [](SceneParams &scene) { scene.view_scale = 0.2f; });
+    vary("zoom_4", [](SceneParams &scene) { scene.view_scale = 4.0f; });
+
+    return scenes;
+}
+
+//!
+//! Generates the tree of a scene
+//!
+//! \param ctx A pointer to the context the tree belongs to
+//! \param scene The scene's parameters
+//!
+static void generateScene(std::shared_ptr<RgfCtx> ctx, const SceneParams &scene)
+{
+    std::shared_ptr<Tree> tree = ctx->tree();
+
+    tree->setNumBranches(scene.depth);
+    tree->setSpawnPointTransformation(QTransform().translate(60, 0).rotate(-10).scale(scene.spawn_scale, scene.spawn_scale));
+
+    for (uint i = 0; i < scene.num_leaves; i++) {
+        qreal angle = 360.0 * i / scene.num_leaves;
+        QPointF position = QTransform().rotate(angle).map(QPointF(kLeafCircleRadius, 0));
+
+        // created as if the view weren't scaled, so that the position is in world space
+        std::shared_ptr<Leaf> leaf = tree->createLeaf(scene.leaf_types[i % scene.leaf_types.size()], position, 1.0);
+        if (leaf != nullptr) {
+            leaf->setTransformationMatrix(QTransform(leaf->matrix()).rotate(angle).scale(kLeafScale, kLeafScale));
+        }
+    }
+}
+
+//!
+//! \return The peak resident memory of the process so far in kilobytes, or 0 if it's unknown on this platform
+//!
+static qint64 peakMemoryKb()
+{
+#ifdef Q_OS_UNIX
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+
+#ifdef Q_OS_MACOS
+    // bytes on macOS, kilobytes elsewhere
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+//!
+//! Draws a scene repeatedly and measures how long each frame takes
+//!
+//! \param scene The scene's parameters
+//! \param size Size of the view area
+//! \param num_warmup_frames How many frames are drawn before measuring, e.g. so that the thread pool has started
+//! \param num_frames How many frames are measured
+//! \return The results of the scene
+//!
+static QJsonObject runScene(const SceneParams &scene, QSize size, uint num_warmup_frames, uint num_frames)
+{
+    std::shared_ptr<RgfCtx> ctx = RgfCtx::createHeadless();
+    generateScene(ctx, scene);
+
+    std::shared_ptr<Tree> tree = ctx->tree();
+
+    View view = {QPointF(size.width(), size.height()), QPointF(size.width(), size.height()) / 2, scene.view_scale};
+    FrameRequest request = {tree, view, {ctx_mode_t::view, 0, scene.view_scale}, tree->getRevision()};
+
+    // 32-bit, so that the tree is drawn in parallel tiles, same as by the render thread
+    QImage image(size, QImage::Format_RGB32);
+
+    std::vector<qint64> frame_times_ns;
+    frame_times_ns.reserve(num_frames);
+    uint64_t allocation_count = 0;
+
+    for (uint i = 0; i < num_warmup_frames + num_frames; i++) {
+        if (i == num_warmup_frames) {
+            allocation_count = allocationCount();
+        }
+
+        std::shared_ptr<QPainter> painter = std::make_shared<QPainter>(&image);
+
+        std::chrono::steady_clock::time_point drawing_start = std::chrono::steady_clock::now();
+        Renderer::drawScene(painter, request);
+        painter->end();
+        std::chrono::steady_clock::time_point drawing_end = std::chrono::steady_clock::now();
+
+        if (i >= num_warmup_frames) {
+            frame_times_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(drawing_end - drawing_start).count());
+        }
+    }
+
+    allocation_count = allocationCount() - allocation_count;
+
+    qint64 total_ns = std::reduce(frame_times_ns.begin(), frame_times_ns.end(), qint64(0));
+    size_t num_instances = tree->getNumInstances();
+
+    QJsonObject result;
+    result["name"] = scene.name;
+    result["num_leaves"] = static_cast<int>(scene.num_leaves);
+    result["depth"] = static_cast<int>(scene.depth);
+    result["spawn_scale"] = scene.spawn_scale;
+    result["view_scale"] = scene.view_scale;
+    result["effective_depth"] = static_cast<int>(tree->getStatistics().effective_depth);
+    result["num_instances"] = static_cast<qint64>(num_instances);
+    result["frames_per_second"] = total_ns > 0 ? 1e9 * frame_times_ns.size() / total_ns : 0.0;
+    result["mean_frame_ms"] = frame_times_ns.empty() ? 0.0 : total_ns / 1e6 / frame_times_ns.size();
+    result["min_frame_ms"] = frame_times_ns.empty() ? 0.0 : *std::min_element(frame_times_ns.begin(), frame_times_ns.end()) / 1e6;
+    result["max_frame_ms"] = frame_times_ns.empty() ? 0.0 : *std::max_element(frame_times_ns.begin(), frame_times_ns.end()) / 1e6;
+    result["ns_per_instance"] = num_instances > 0 && !frame_times_ns.empty() ?
+                                    static_cast<double>(total_ns) / frame_times_ns.size() / num_instances : 0.0;
+    if (kCountAllocations) {
+        result["allocations_per_frame"] = static_cast<double>(allocation_count) / frame_times_ns.size();
+    }
+    // the peak of the whole process so far, so it only grows from scene to scene
+    result["peak_memory_kb"] = peakMemoryKb();
+
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    // nothing is shown on the screen, so don't require one unless a platform has been chosen explicitly
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QGuiApplication app(argc, argv);
+    QGuiApplication::setApplicationName("RegrafusionBenchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures how fast synthetic Regrafusion trees are drawn offscreen and writes the results as JSON.");
+    parser.addHelpOption();
+
+    QCommandLineOption output_option({"o", "output"}, "JSON file to write the results to, instead of the standard output.", "file");
+    QCommandLineOption size_option({"s", "size"}, "Size of the view area in pixels.", "WxH", "1920x1080");
+    QCommandLineOption frames_option({"f", "frames"}, "How many frames of each scene are measured.", "n", "50");
+    QCommandLineOption warmup_option("warmup", "How many frames of each scene are drawn before measuring.", "n", "5");
+    QCommandLineOption scene_option("scene", "Only run the scenes with the given names; may be repeated.", "name");
+    QCommandLineOption trace_option("trace", "Write the drawing phases as Chrome trace-event JSON to the given file; tracing "
+                                    "slows drawing down, so the results aren't comparable to untraced runs.", "file");
+    QCommandLineOption list_option("list", "List the names of all scenes and exit.");
+    parser.addOptions({output_option, size_option, frames_option, warmup_option, scene_option, trace_option, list_option});
+
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    std::vector<SceneParams> scenes = benchmarkScenes();
+
+    if (parser.isSet(list_option)) {
+        for (const SceneParams &scene : scenes) {
+            out << scene.name << Qt::endl;
+        }
+        return 0;
+    }
+
+    QStringList size_parts = parser.value(size_option).split('x');
+    QSize size = size_parts.size() == 2 ? QSize(size_parts[0].toInt(), size_parts[1].toInt()) : QSize();
+    if (size.width() < 1 || size.height() < 1) {
+        err << "Invalid size: " << parser.value(size_option) << Qt::endl;
+        return 1;
+    }
+
+    bool frames_ok = false;
+    bool warmup_ok = false;
+    uint num_frames = parser.value(frames_option).toUInt(&frames_ok);
+    uint num_warmup_frames = parser.value(warmup_option).toUInt(&warmup_ok);
+    if (!frames_ok || num_frames == 0 || !warmup_ok) {
+        err << "Invalid number of frames" << Qt::endl;
+        return 1;
+    }
+
+    QStringList selected_scenes = parser.values(scene_option);
+
+    if (parser.isSet(trace_option)) {
+        Tracer::instance().start(parser.value(trace_option));
+    }
+
+    QJsonArray results;
+    for (const SceneParams &scene : scenes) {
+        if (!selected_scenes.isEmpty() && !selected_scenes.contains(scene.name)) {
+            continue;
+        }
+
+        results.append(runScene(scene, size, num_warmup_frames, num_frames));
+    }
+
+    if (parser.isSet(trace_option) && !Tracer::instance().stop()) {
+        err << "Couldn't write " << parser.value(trace_option) << Qt::endl;
+        return 1;
+    }
+
+    QJsonObject report;
+    report["width"] = size.width();
+    report["height"] = size.height();
+    report["frames"] = static_cast<int>(num_frames);
+    report["scenes"] = results;
+
+    QByteArray json = QJsonDocument(report).toJson();
+
+    if (!parser.isSet(output_option)) {
+        out << json;
+        return 0;
+    }
+
+    QFile file(parser.value(output_option));
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+        err << "Couldn't write " << file.fileName() << Qt::endl;
+        return 1;
+    }
+
+    return 0;
+}
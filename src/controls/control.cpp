@@ -21,14 +21,7 @@ Control::~Control()
 
 QTransform Control::calculateTotalLeafTransforamtion()
 {
-    QTransform tfm = leaf_->matrix();
-    QTransform spawn_tfm = ctx_->getSpawnPointTransformation();
-
-    for (uint i = 0; i < leaf_depth_; i++) {
-        tfm *= spawn_tfm;
-    }
-
-    return tfm;
+    return leaf_->matrix() * ctx_->getSpawnPointTransformation(leaf_depth_);
 }
 
 QPointF Control::mapLeafSpaceToScreenSpace(QPointF point)
@@ -83,7 +83,7 @@ void PathControl::drawMoveVertexMode(std::shared_ptr<QPainter> painter)
     painter->setBrush(Qt::black);
     painter->setPen(Qt::transparent);
 
-    for (QPointF& point : points()) {
+    for (const QPointF& point : points()) {
         QPointF mapped = mapLeafSpaceToScreenSpace(point);
         if (getPointDistance(mouse_position_, mapped) > kPopUpDistance)
             continue;
@@ -197,7 +197,7 @@ bool PathControl::handleMouseButtonPress(QMouseEvent *event)
 bool PathControl::startDraggingVertex()
 {
     uint index = 0;
-    for (QPointF& point : points()) {
+    for (const QPointF& point : points()) {
         QPointF mapped = mapLeafSpaceToScreenSpace(point);
 
         if (getPointDistance(mouse_position_, mapped) <= kPopUpDistance) {
@@ -215,7 +215,7 @@ bool PathControl::startDraggingVertex()
 bool PathControl::addVertex()
 {
     side_t side = findClosestSideToCursor();
-    points().insert(points().begin() + side.ind + 1, mapScreenSpaceToLeafSpace(mouse_position_));
+    path_->insertPoint(side.ind + 1, mapScreenSpaceToLeafSpace(mouse_position_));
     ctx_->refresh();
     return true;
 }
@@ -241,7 +241,7 @@ bool PathControl::removeVertex()
     if (index_to_remove < 0)
         return true;
 
-    points().erase(points().begin() + index_to_remove);
+    path_->removePoint(index_to_remove);
     ctx_->refresh();
 
     return true;
@@ -254,8 +254,7 @@ bool PathControl::handleMouseMove(QMouseEvent *event)
 
     if (vertex_dragged_) {
         QPointF deltaPosition = leaf_->fromSreenSpace(ctx_, mouse_position_) - leaf_->fromSreenSpace(ctx_, previous_mouse_position_);
-        points()[dragged_vertex_index_].rx() += deltaPosition.x();
-        points()[dragged_vertex_index_].ry() += deltaPosition.y();
+        path_->movePoint(dragged_vertex_index_, deltaPosition);
         event_blocked = true;
     }
 
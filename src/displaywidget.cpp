@@ -2,6 +2,9 @@
 // Distributed under GPL-3.0
 // Copyright (C) 2023-2024  Vesko Milev
 
+#include <algorithm>
+#include <chrono>
+#include <optional>
 #include <QGuiApplication>
 #include <QEvent>
 #include <QMouseEvent>
@@ -16,7 +19,9 @@
 #include "gfx/tree.h"
 #include "leaf_identifier.h"
 #include "math.h"
+#include "renderer.h"
 #include "rgf_ctx.h"
+#include "trace.h"
 #include "uipainter.h"
 
 DisplayWidget::DisplayWidget(QWidget* parent) :
@@ -26,7 +31,13 @@ DisplayWidget::DisplayWidget(QWidget* parent) :
     previous_mouse_position_(View::kOffsetIdentity),
     draw_user_view_buffer_(true),
     dragged_leaf_ {false, leaf_type_t::circle, QPointF(0, 0)},
-    mouse_dragged_(false)
+    mouse_dragged_(false),
+    renderer_(std::make_unique<Renderer>()),
+    frame_requested_(true),
+    submitted_request_({}),
+    displayed_frame_(nullptr),
+    displayed_tree_(nullptr),
+    displayed_view_(view_)
 {
     // initial window size during constructor invocation is miniscule, so set the view offset on first resizeGL() call
     // (which always gets called on start before paintGL())
@@ -36,56 +47,135 @@ DisplayWidget::DisplayWidget(QWidget* parent) :
     setAcceptDrops(true);
 
     setMouseTracking(true);
+
+    // frames are finished on the render thread, so the repaint is queued onto the GUI thread
+    connect(renderer_.get(), &Renderer::frameReady, this, [this]() { update(); });
+}
+
+DisplayWidget::~DisplayWidget()
+{
 }
 
 void DisplayWidget::paintGL()
 {
+    TraceZone paint_zone("paintGL", "frame");
+
     std::shared_ptr<QPainter> painter = std::make_shared<QPainter>(ctx_->userViewBuffer().get());
-    std::shared_ptr<QPainter> color_id_painter = std::make_shared<QPainter>(ctx_->colorIdBuffer().get());
+    TreeStatistics stats = {};
 
-    initializeDrawBuffers(painter, color_id_painter);
+    if (draw_user_view_buffer_) {
+        if (frame_requested_) {
+            FrameRequest request = createFrameRequest();
+
+            // e.g. the cursor has only moved, so the last frame is still up to date
+            if (submitted_request_.tree == nullptr || !request.drawsSameFrame(submitted_request_)) {
+                request.tree = ctx_->tree()->snapshot();
+                renderer_->submit(request);
+                submitted_request_ = request;
+            }
 
-    UiPainter uipainter(view_, painter);
+            frame_requested_ = false;
+        }
 
-    if (ctx_->getMode() != RgfCtx::mode_t::view) {
-        uipainter.drawGridAndAxes();
-        uipainter.drawRulerNumbers();
-    }
+        // the displayed frame may lag behind the overlays, until the render thread catches up
+        std::shared_ptr<Frame> frame = renderer_->swapFrame(displayed_frame_);
+        if (frame != displayed_frame_) {
+            displayed_frame_ = frame;
+            displayed_tree_ = frame->request.tree;
+            displayed_view_ = frame->request.view;
+            ctx_->tree()->setStatistics(frame->stats);
 
-    // above elements are at constant relative position - they shouldn't be affected by the matrix
-    // also, grid and axes look better when they're always a single pixel wide
-    painter->setWorldMatrixEnabled(true);
-    painter->setWorldTransform(QTransform(view_.scale, 0, 0, view_.scale, view_.offset.x(), view_.offset.y()));
+            if (frame->complete) {
+                keepZoomLevel(*frame);
+            }
+        }
 
-    color_id_painter->setWorldMatrixEnabled(true);
-    color_id_painter->setWorldTransform(QTransform(view_.scale, 0, 0, view_.scale, view_.offset.x(), view_.offset.y()));
+        std::chrono::steady_clock::time_point frame_start = std::chrono::steady_clock::now();
+        TraceZone frame_zone("frame", "frame");
+
+        if (displayed_frame_ != nullptr && displayed_frame_->complete && displayed_frame_->request.drawsSameFrame(submitted_request_)) {
+            painter->drawImage(0, 0, displayed_frame_->image);
+        } else {
+            // e.g. the view has just been zoomed, so the frame for it is still being drawn
+            drawPreview(painter);
+        }
+
+        paint_stats_.frame_time_us.push(std::chrono::duration_cast<std::chrono::microseconds>(
+                                            std::chrono::steady_clock::now() - frame_start).count());
 
-    // draw the tree itself
-    TreeStatistics stats = ctx_->tree()->draw(painter, color_id_painter);
+        if (displayed_frame_ != nullptr) {
+            stats = displayed_frame_->stats;
+        }
+    } else {
+        // the color id buffer is only shown for debugging purposes, so it's drawn right away, along with the view area
+        FrameRequest request = createFrameRequest();
+        request.tree = ctx_->tree()->snapshot();
+        stats = Renderer::drawScene(painter, request, initializeColorIdBuffer());
+        ctx_->tree()->setStatistics(stats);
+
+        displayed_tree_ = request.tree;
+        displayed_view_ = request.view;
+    }
+
+    std::chrono::steady_clock::time_point overlay_start = std::chrono::steady_clock::now();
+    std::optional<TraceZone> overlay_zone(std::in_place, "overlays", "frame");
+
+    painter->setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
+    painter->setWorldMatrixEnabled(true);
+    painter->setWorldTransform(view_.transform());
 
     if (ctx_->getMode() != RgfCtx::mode_t::view) {
         // draw a new DnD leaf
         drawDraggedLeaf(painter);
     }
 
+    // controls aren't part of the tree, so they're drawn on top of it, with the current view
+    if (ctx_->getSelectedLeaf() != nullptr) {
+        ctx_->getSelectedLeaf()->drawControls(painter);
+    }
+
     // disable the matrix for overlaid elements
     painter->setWorldMatrixEnabled(false);
 
+    // the border and the rulers stay at the edges of the view area, so they aren't part of frames, which are shifted by panning
+    painter->setPen(Qt::gray);
+    painter->drawRect(1, 0, view_.size.x() - 1, view_.size.y() - 1);
+
+    UiPainter uipainter(view_, painter);
+
     if (ctx_->getMode() != RgfCtx::mode_t::view) {
+        uipainter.drawRulerNumbers();
+
         // overlay coordinate labels on top of drawn elements
         uipainter.drawCoordinateLabels();
 
-        uipainter.drawStats(stats);
+        uipainter.drawStats(stats, paint_stats_);
 
         uipainter.drawCtxMode(ctx_->getMode());
     }
 
+    std::chrono::steady_clock::time_point blit_start = std::chrono::steady_clock::now();
+    paint_stats_.overlay_time_us.push(std::chrono::duration_cast<std::chrono::microseconds>(blit_start - overlay_start).count());
+    overlay_zone.reset();
+
+    TraceZone blit_zone("blit", "frame");
+
     QPainter display_painter(this);
     if (draw_user_view_buffer_) {
         display_painter.drawImage(0, 0, *ctx_->userViewBuffer());
     } else {
         display_painter.drawImage(0, 0, *ctx_->colorIdBuffer());
     }
+    display_painter.end();
+
+    paint_stats_.blit_time_us.push(std::chrono::duration_cast<std::chrono::microseconds>(
+                                       std::chrono::steady_clock::now() - blit_start).count());
+}
+
+void DisplayWidget::refresh()
+{
+    frame_requested_ = true;
+    update();
 }
 
 void DisplayWidget::resizeGL(int w, int h)
@@ -100,20 +190,21 @@ void DisplayWidget::resizeGL(int w, int h)
 
     limitViewPosition();
     updateStatus();
+    refresh();
 }
 
 void DisplayWidget::resetViewPosition()
 {
     view_.offset = view_.size / 2;
     updateStatus();
-    update();
+    refresh();
 }
 
 void DisplayWidget::resetViewScale()
 {
     view_.scale = 1.0f;
     updateStatus();
-    update();
+    refresh();
 }
 
 void DisplayWidget::setStatusBar(QStatusBar * const &bar)
@@ -127,14 +218,83 @@ void DisplayWidget::switchBuffers()
     draw_user_view_buffer_ = !draw_user_view_buffer_;
 }
 
-void DisplayWidget::initializeDrawBuffers(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter)
+void DisplayWidget::drawPreview(std::shared_ptr<QPainter> painter)
 {
-    painter->setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
     painter->fillRect(QRectF(View::kOffsetIdentity, view_.size), Qt::white);
-    painter->setPen(Qt::gray);
-    painter->drawRect(1, 0, view_.size.x() - 1, view_.size.y() - 1);
+
+    // only levels of the tree as it is now can stand in for the frame that is being drawn
+    std::vector<const Frame *> layers;
+    for (const Frame &level : zoom_levels_) {
+        if (level.request.revision == submitted_request_.revision &&
+            level.request.draw_state.mode == submitted_request_.draw_state.mode &&
+            level.request.draw_state.selected_leaf_depth == submitted_request_.draw_state.selected_leaf_depth) {
+            layers.push_back(&level);
+        }
+    }
+
+    std::sort(layers.begin(), layers.end(), [](const Frame *a, const Frame *b) {
+        return a->request.view.scale < b->request.view.scale;
+    });
+
+    // a partly drawn frame would cover the levels below it, so it's only shown if there are none
+    if (layers.empty() && displayed_frame_ != nullptr) {
+        layers.push_back(displayed_frame_.get());
+    }
+
+    painter->setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
+
+    for (const Frame *layer : layers) {
+        painter->setWorldTransform(layer->request.view.transformTo(view_));
+        painter->drawImage(0, 0, layer->image);
+    }
+
+    painter->setWorldTransform(QTransform());
+}
+
+void DisplayWidget::keepZoomLevel(const Frame &frame)
+{
+    const FrameRequest &request = frame.request;
+
+    zoom_levels_.erase(
+        std::remove_if(
+            zoom_levels_.begin(),
+            zoom_levels_.end(),
+            [&request](const Frame &level) {
+                return level.request.revision != request.revision ||
+                       qAbs(level.request.view.scale / request.view.scale - 1) < kZoomLevelScaleTolerance;
+            }
+            ),
+        zoom_levels_.end()
+        );
+
+    // images are implicitly shared, so the level doesn't copy any pixels, and the render thread detaches from it before it
+    // reuses the frame
+    Frame level = frame;
+    level.request.tree = nullptr;
+    zoom_levels_.push_back(level);
+
+    if (zoom_levels_.size() > kMaxZoomLevels) {
+        zoom_levels_.erase(zoom_levels_.begin());
+    }
+}
+
+FrameRequest DisplayWidget::createFrameRequest() const
+{
+    return {nullptr, view_, {ctx_->getMode(), ctx_->getSelectedLeafDepth(), view_.scale}, ctx_->tree()->getRevision()};
+}
+
+std::shared_ptr<QPainter> DisplayWidget::initializeColorIdBuffer()
+{
+    TraceZone zone("initializeColorIdBuffer", "frame");
+
+    std::shared_ptr<QPainter> color_id_painter = std::make_shared<QPainter>(ctx_->colorIdBuffer().get());
 
     color_id_painter->fillRect(QRectF(View::kOffsetIdentity, view_.size), ctx_->leafIdentifier()->getBackgroundColor());
+
+    color_id_painter->setWorldMatrixEnabled(true);
+    color_id_painter->setWorldTransform(view_.transform());
+
+    return color_id_painter;
 }
 
 bool DisplayWidget::eventFilter(QObject *obj, QEvent *event)
@@ -178,8 +338,20 @@ bool DisplayWidget::eventFilter(QObject *obj, QEvent *event)
 
             ctx_->tree()->deselect();
 
+            // the color id pass is exact with respect to what has been drawn, whereas hit testing is more lenient towards near misses
             uint leaf_depth = 0;
-            auto leaf = ctx_->leafIdentifier()->getLeaf(ctx_->colorIdBuffer(), cursor_position, leaf_depth);
+            std::shared_ptr<Leaf> leaf = nullptr;
+            if (displayed_tree_ != nullptr) {
+                // while a preview is shown, the displayed frame is transformed to the current view, so the cursor is mapped back
+                // to the view the frame was drawn for
+                QPointF displayed_position = view_.transformTo(displayed_view_).map(cursor_position);
+
+                leaf = ctx_->leafIdentifier()->pick(displayed_tree_, ctx_->colorIdBuffer(), displayed_view_.transform(),
+                                                    displayed_position, leaf_depth);
+                if (leaf == nullptr) {
+                    leaf = displayed_tree_->getLeaf(displayed_position, leaf_depth);
+                }
+            }
             if (leaf != nullptr) {
                 ctx_->setSelectedLeaf(leaf, leaf_depth);
                 leaf->select();
@@ -190,7 +362,7 @@ bool DisplayWidget::eventFilter(QObject *obj, QEvent *event)
 
         }
 
-        update();
+        refresh();
 
         return true;
     }
@@ -206,7 +378,7 @@ bool DisplayWidget::eventFilter(QObject *obj, QEvent *event)
         }
 
         updateStatus();
-        update();
+        refresh();
         previous_mouse_position_ = mouseEvent->pos();
         return true;
     }
@@ -270,7 +442,7 @@ void DisplayWidget::wheelEvent(QWheelEvent *event)
         view_.offset = (view_.offset - view_.size / 2) * scale_factor + view_.size / 2;
 
         updateStatus();
-        update();
+        refresh();
     }
 
     event->accept();
@@ -327,7 +499,6 @@ void DisplayWidget::dropEvent(QDropEvent *event)
     }
 
     ctx_->createLeaf(leaf_type, event->position() - view_.offset, view_.scale);
-    update();
     event->acceptProposedAction();
 }
 
@@ -2,7 +2,7 @@
 // Distributed under GPL-3.0
 // Copyright (C) 2023-2024  Vesko Milev
 
-#include <chrono>
+#include <algorithm>
 
 #include "gfx/branch.h"
 #include "gfx/leaves/circle.h"
@@ -13,71 +13,23 @@
 #include "rgf_ctx.h"
 
 Branch::Branch(std::weak_ptr<RgfCtx> ctx) :
-    ctx_(ctx)
+    ctx_(ctx),
+    revision_(nextRevision())
 {
     std::shared_ptr<RgfCtx> ctx_p = ctx_.lock();
 
     assert(ctx_p != nullptr && "Branch was created for a non existant context");
 
     auto leaf = Leaf::constructNew(ctx_p, leaf_type_t::spawn_point);
-    leaf->setTransformationMatrix(leaf->matrix().translate(60, 0).rotate(-10).scale(0.98, 0.98));
+    leaf->setTransformationMatrix(QTransform().translate(60, 0).rotate(-10).scale(0.98, 0.98));
     leaves_.push_back(leaf);
 }
 
-void Branch::draw(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter, uint num_iterations, BranchStatistics& stats, uint depth)
+Branch::Branch(std::weak_ptr<RgfCtx> ctx, std::vector<std::shared_ptr<Leaf>> leaves) :
+    ctx_(ctx),
+    leaves_(std::move(leaves)),
+    revision_(nextRevision())
 {
-    // each invocation of draw() immediately uses up one iteration
-    num_iterations--;
-
-    // TODO: add a branch's own proper transformation matrix, so that even the first branch can have all of its elements transformed
-
-    std::chrono::steady_clock::time_point drawing_start = std::chrono::steady_clock::now();
-    std::chrono::steady_clock::time_point branching_start = std::chrono::steady_clock::now();
-    std::chrono::steady_clock::time_point branching_end = std::chrono::steady_clock::now();
-
-    // use recursion, because the user may want to draw subbranches above some leaves of the current branch, but below others
-    // and there's provision to allow for multiple spawn points in the future
-    for (auto &leaf : leaves_) {
-
-        if (!leaf->isSpawnPoint()) {
-            leaf->draw(painter, color_id_painter, depth);
-
-            // draw controls on the first iteration, so that they are on top of everything
-            if (depth == 0 && leaf->isSelected()) {
-                leaf->drawControls(painter);
-            }
-
-        } else if (num_iterations > 0) {
-            leaf->draw(painter, color_id_painter, depth);
-
-            // exclude drawing time of subbranches from this branch's stats
-            branching_start = std::chrono::steady_clock::now();
-            draw(painter, color_id_painter, num_iterations, stats, depth + 1);
-            branching_end = std::chrono::steady_clock::now();
-
-            leaf->unapplyLocalTransformations(painter);
-            leaf->unapplyLocalTransformations(color_id_painter);
-        }
-
-    }
-
-    std::chrono::steady_clock::time_point drawing_end = std::chrono::steady_clock::now();
-
-    uint render_time_us;
-    render_time_us = std::chrono::duration_cast<std::chrono::microseconds>(drawing_end - drawing_start).count();
-    render_time_us -= std::chrono::duration_cast<std::chrono::microseconds>(branching_end - branching_start).count();
-
-    // account for the decrement at the start
-    if (num_iterations == stats.num_branches - 1) {
-        stats.first_branch_render_time_us = render_time_us;
-    }
-
-    // if there are no more iterations left, this is the last branch
-    if (num_iterations == 0) {
-        stats.last_branch_render_time_us = render_time_us;
-    }
-
-    stats.branch_render_times_us.push_back(render_time_us);
 }
 
 void Branch::deselect()
@@ -99,6 +51,18 @@ QTransform Branch::getSpawnPointTransformation()
     return QTransform();
 }
 
+bool Branch::setSpawnPointTransformation(QTransform transformation)
+{
+    // spawn points are only created by the constructor, so the first one found is the branch's only one
+    for (auto &leaf : leaves_) {
+        if (leaf->isSpawnPoint()) {
+            return leaf->setTransformationMatrix(transformation);
+        }
+    }
+
+    return false;
+}
+
 void Branch::deleteLeaf(std::shared_ptr<Leaf> leaf)
 {
     if (leaf == nullptr)
@@ -115,6 +79,18 @@ void Branch::deleteLeaf(std::shared_ptr<Leaf> leaf)
             [leaf](std::shared_ptr<Leaf> element) { return element == leaf; }
             )
         );
+
+    revision_ = nextRevision();
+}
+
+uint64_t Branch::getRevision() const
+{
+    uint64_t revision = revision_;
+    for (const auto &leaf : leaves_) {
+        revision = std::max(revision, leaf->getRevision());
+    }
+
+    return revision;
 }
 
 std::shared_ptr<Leaf> Branch::createLeaf(leaf_type_t leaf_type, QPointF position, qreal scale)
@@ -123,9 +99,22 @@ std::shared_ptr<Leaf> Branch::createLeaf(leaf_type_t leaf_type, QPointF position
     assert(ctx_p != nullptr && "Branch exists for a non existant context");
 
     auto leaf = Leaf::constructNew(ctx_p, leaf_type);
-    leaf->matrix().scale(1 / scale, 1 / scale);
-    leaf->matrix().translate(position.rx(), position.ry());
+    leaf->setTransformationMatrix(QTransform().scale(1 / scale, 1 / scale).translate(position.rx(), position.ry()));
     leaves_.push_back(leaf);
+    revision_ = nextRevision();
 
     return leaf;
 }
+
+std::unique_ptr<Branch> Branch::clone() const
+{
+    std::vector<std::shared_ptr<Leaf>> leaves;
+    leaves.reserve(leaves_.size());
+
+    for (const auto &leaf : leaves_) {
+        leaves.push_back(leaf->clone());
+    }
+
+    // a plain new, since the ctor is private
+    return std::unique_ptr<Branch>(new Branch(ctx_, std::move(leaves)));
+}
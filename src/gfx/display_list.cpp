@@ -0,0 +1,592 @@
+// Regrafusion - draws graphics recursively
+// Distributed under GPL-3.0
+// Copyright (C) 2024  Vesko Milev
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+#include "gfx/display_list.h"
+#include "gfx/leaf.h"
+#include "leaf_identifier.h"
+#include "math_utils.h"
+#include "trace.h"
+
+//!
+//! \return The thread pool that all display lists draw with. A display list is compiled for each snapshot of the tree, so
+//! display lists share the pool, instead of each one starting its own threads.
+//!
+static QThreadPool * sharedThreadPool()
+{
+    static QThreadPool thread_pool;
+    return &thread_pool;
+}
+
+//!
+//! \param type A leaf type
+//! \return The name of the type, as shown in traces
+//!
+static const char * leafTypeName(leaf_type_t type)
+{
+    switch (type) {
+    case leaf_type_t::spawn_point:
+        return "spawn point";
+    case leaf_type_t::circle:
+        return "circle";
+    case leaf_type_t::line:
+        return "line";
+    case leaf_type_t::rectangle:
+        return "rectangle";
+    case leaf_type_t::path:
+        return "path";
+    default:
+        return "leaf";
+    }
+}
+
+DisplayList::DisplayList() :
+    has_tail_bounds_(false),
+    next_instance_(0),
+    draw_state_({ctx_mode_t::navigation, 0, 1.0}),
+    thread_pool_(sharedThreadPool()),
+    num_depths_(0)
+{
+}
+
+void DisplayList::compile(const std::vector<std::unique_ptr<Branch>> &branches, uint num_branches, const QTransform &root_transform,
+                          const QRectF &visible_area, const LeafDrawState &draw_state, qreal min_branch_size)
+{
+    TraceZone zone("DisplayList::compile", "tree");
+
+    instances_.clear();
+    selected_instances_.clear();
+    num_depths_ = 0;
+    next_instance_ = 0;
+    visible_area_ = visible_area;
+
+    if (num_branches == 0) {
+        return;
+    }
+
+    for (auto &branch : branches) {
+        leaf_bounds_.clear();
+        branch_bounds_ = QRectF();
+        for (auto &leaf : branch->leaves()) {
+            // the color id pass and the selection pass draw the same instances, so their bounds have to contain both
+            QRectF bounds = leaf->getBoundingRect().united(leaf->getColorIdBoundingRect(draw_state.view_scale));
+            if (leaf->isSelected() && draw_state.mode == ctx_mode_t::edit) {
+                bounds = bounds.united(Leaf::getSelectionBoundingRect());
+            }
+            leaf_bounds_.push_back(bounds);
+            // QRectF::united() ignores empty rectangles
+            branch_bounds_ = branch_bounds_.united(leaf->matrix().mapRect(leaf_bounds_.back()));
+        }
+        calculateTailBounds(*branch);
+
+        pending_branches_.push_back({branch.get(), root_transform, 0, 0});
+
+        while (!pending_branches_.empty()) {
+            PendingBranch &current = pending_branches_.back();
+            const std::vector<std::shared_ptr<Leaf>> &leaves = current.branch->leaves();
+
+            if (current.next_leaf >= leaves.size()) {
+                pending_branches_.pop_back();
+                continue;
+            }
+
+            Leaf *leaf = leaves[current.next_leaf].get();
+            const QRectF &local_bounds = leaf_bounds_[current.next_leaf];
+            current.next_leaf++;
+
+            // same order of multiplication as QPainter::setWorldTransform() with the combine flag set
+            QTransform transform = leaf->matrix() * current.transform;
+            QRectF bounds = transform.mapRect(local_bounds);
+            bool culled = isCulled(bounds, visible_area);
+
+            num_depths_ = std::max(num_depths_, current.depth + 1);
+
+            if (!leaf->isSpawnPoint()) {
+                if (!culled) {
+                    addInstance({leaf, transform, current.depth, bounds});
+                }
+                continue;
+            }
+
+            // the last branch doesn't spawn anything
+            if (current.depth + 1 >= num_branches) {
+                continue;
+            }
+
+            // even if the spawn point itself isn't visible, the branches it spawns may be
+            if (!culled) {
+                addInstance({leaf, transform, current.depth, bounds});
+            }
+
+            // a spawn point spawns an instance of its own branch; there's provision to allow for multiple spawn points in the future,
+            // so subbranches may be drawn above some leaves of the current branch, but below others
+            // GOTCHA: push_back() may invalidate the reference to the current branch, so copy everything needed beforehand
+            const Branch *spawned_branch = current.branch;
+            uint spawned_depth = current.depth + 1;
+
+            // the spawned branch and everything it spawns lie within the tail bounds, so if they aren't visible, the whole
+            // rest of the recursion can be skipped at once instead of culling it instance by instance
+            if (has_tail_bounds_ && isCulled(transform.mapRect(tail_bounds_), visible_area)) {
+                continue;
+            }
+
+            // the spawn transformation is a contraction, so once a branch is too small, all branches spawned after it are too
+            if (has_tail_bounds_ && min_branch_size > 0) {
+                QRectF spawned_bounds = transform.mapRect(branch_bounds_);
+                if (spawned_bounds.width() < min_branch_size && spawned_bounds.height() < min_branch_size) {
+                    continue;
+                }
+            }
+
+            pending_branches_.push_back({spawned_branch, transform, spawned_depth, 0});
+        }
+    }
+}
+
+void DisplayList::draw(std::shared_ptr<QPainter> painter, const LeafDrawState &draw_state, BranchStatistics &stats,
+                       std::shared_ptr<QPainter> color_id_painter, LeafIdentifier *leaf_identifier)
+{
+    beginDraw(draw_state);
+
+    // the two passes write to different images and only read the list, so they don't need any synchronisation
+    bool draw_color_ids = color_id_painter != nullptr && leaf_identifier != nullptr;
+    if (draw_color_ids) {
+        thread_pool_->start([this, color_id_painter, leaf_identifier]() {
+            drawColorIds(color_id_painter, *leaf_identifier);
+        });
+    }
+
+    drawRange(painter.get(), 0, instances_.size());
+    next_instance_ = instances_.size();
+    drawSelection(painter.get());
+
+    if (draw_color_ids) {
+        thread_pool_->waitForDone();
+    }
+
+    getStatistics(stats);
+}
+
+void DisplayList::beginDraw(const LeafDrawState &draw_state, const QRegion &drawn_area)
+{
+    draw_state_ = draw_state;
+    drawn_area_ = drawn_area.isEmpty() ? QRegion(visible_area_.toAlignedRect()) : drawn_area.intersected(visible_area_.toAlignedRect());
+    next_instance_ = 0;
+
+    // single instances are often drawn in less than a microsecond, so accumulate nanoseconds
+    depth_render_times_ns_.assign(num_depths_, 0);
+}
+
+bool DisplayList::drawNext(std::shared_ptr<QPainter> painter, std::chrono::nanoseconds budget)
+{
+    std::chrono::steady_clock::time_point drawing_start = std::chrono::steady_clock::now();
+    size_t first_instance = next_instance_;
+    size_t chunk_size = kMinChunkSize;
+
+    while (next_instance_ < instances_.size()) {
+        size_t end = std::min(instances_.size(), next_instance_ + chunk_size);
+        drawRange(painter.get(), next_instance_, end);
+        next_instance_ = end;
+
+        std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - drawing_start;
+        if (elapsed >= budget) {
+            break;
+        }
+
+        // estimate how many more instances fit in the budget, based on how long the drawn ones took
+        uint64_t ns_per_instance = std::max<uint64_t>(1, elapsed.count() / (next_instance_ - first_instance));
+        chunk_size = std::max<size_t>(kMinChunkSize, (budget - elapsed).count() / ns_per_instance);
+    }
+
+    if (next_instance_ < instances_.size()) {
+        return false;
+    }
+
+    drawSelection(painter.get());
+    return true;
+}
+
+void DisplayList::getStatistics(BranchStatistics &stats) const
+{
+    if (depth_render_times_ns_.empty()) {
+        return;
+    }
+
+    uint64_t total_render_time_ns = std::accumulate(depth_render_times_ns_.begin(), depth_render_times_ns_.end(), uint64_t(0));
+
+    stats.first_branch_render_time_us = depth_render_times_ns_.front() / 1000;
+    stats.last_branch_render_time_us = depth_render_times_ns_.back() / 1000;
+    stats.avg_branch_render_time_us = total_render_time_ns / depth_render_times_ns_.size() / 1000;
+}
+
+void DisplayList::drawRange(QPainter *painter, size_t begin, size_t end)
+{
+    if (begin >= end) {
+        return;
+    }
+
+    QImage *buffer = dynamic_cast<QImage *>(painter->device());
+
+    if (buffer != nullptr && buffer->format() == QImage::Format_RGB32 && thread_pool_->maxThreadCount() > 1) {
+        // a drawn area that isn't a rectangle (e.g. the strips exposed by panning) is drawn rectangle by rectangle; tiles and
+        // slices never draw outside of the area they're given, so the rest is left untouched
+        for (const QRect &rect : drawn_area_) {
+            QRect area = rect.intersected(buffer->rect());
+
+            // if most instances are in a single tile (e.g. in the dense center of a spiral), tiles don't spread the work evenly
+            if (sortIntoTiles(area, begin, end) > (end - begin) * kMaxTileShare) {
+                drawSlices(painter, area, begin, end);
+            } else {
+                drawTiles(painter, *buffer);
+            }
+        }
+    } else {
+        // instance transformations are absolute, so the current one has to be restored after drawing
+        const QTransform painter_transform = painter->worldTransform();
+        QRectF drawn_bounds = QRectF(drawn_area_.boundingRect()).adjusted(-kAntialiasingMargin, -kAntialiasingMargin,
+                                                                          kAntialiasingMargin, kAntialiasingMargin);
+
+        RenderContext context(painter, draw_state_);
+        TraceRun depth_run("branch", "branch", "depth");
+
+        for (size_t i = begin; i < end; i++) {
+            if (!instances_[i].bounds.intersects(drawn_bounds)) {
+                continue;
+            }
+
+            depth_run.step(instances_[i].depth);
+            drawInstance(context, instances_[i], QTransform(), depth_render_times_ns_);
+        }
+
+        painter->setWorldTransform(painter_transform, false);
+    }
+}
+
+size_t DisplayList::sortIntoTiles(const QRect &area, size_t begin, size_t end)
+{
+    tiles_.clear();
+
+    if (area.isEmpty()) {
+        return 0;
+    }
+
+    int num_columns = (area.width() + kTileSize - 1) / kTileSize;
+    int num_rows = (area.height() + kTileSize - 1) / kTileSize;
+
+    tiles_.resize(num_columns * num_rows);
+    for (int row = 0; row < num_rows; row++) {
+        for (int column = 0; column < num_columns; column++) {
+            Tile &tile = tiles_[row * num_columns + column];
+            tile.rect = QRect(area.x() + column * kTileSize, area.y() + row * kTileSize, kTileSize, kTileSize).intersected(area);
+            tile.instances.clear();
+            tile.render_times_ns.assign(num_depths_, 0);
+        }
+    }
+
+    // sort the instances into the tiles they touch; instances are visited in z-order, so each tile keeps it as well
+    for (size_t i = begin; i < end; i++) {
+        QRect bounds = instances_[i].bounds.toAlignedRect().adjusted(-kAntialiasingMargin, -kAntialiasingMargin,
+                                                                     kAntialiasingMargin, kAntialiasingMargin).intersected(area);
+        if (bounds.isEmpty()) {
+            continue;
+        }
+
+        int first_column = (bounds.left() - area.x()) / kTileSize;
+        int last_column = (bounds.right() - area.x()) / kTileSize;
+        int first_row = (bounds.top() - area.y()) / kTileSize;
+        int last_row = (bounds.bottom() - area.y()) / kTileSize;
+
+        for (int row = first_row; row <= last_row; row++) {
+            for (int column = first_column; column <= last_column; column++) {
+                tiles_[row * num_columns + column].instances.push_back(i);
+            }
+        }
+    }
+
+    size_t busiest_tile = 0;
+    for (const Tile &tile : tiles_) {
+        busiest_tile = std::max(busiest_tile, tile.instances.size());
+    }
+
+    return busiest_tile;
+}
+
+void DisplayList::drawTiles(QPainter *painter, QImage &buffer)
+{
+    // every tile is painted by its own painter onto an image that shares the buffer's memory, so tiles are clipped implicitly
+    // and no two threads ever write to the same pixel
+    uchar *bits = buffer.bits();
+    qsizetype bytes_per_line = buffer.bytesPerLine();
+    QPainter::RenderHints render_hints = painter->renderHints();
+
+    for (Tile &tile : tiles_) {
+        if (tile.instances.empty()) {
+            continue;
+        }
+
+        thread_pool_->start([this, &tile, bits, bytes_per_line, render_hints]() {
+            QImage tile_image(bits + tile.rect.y() * bytes_per_line + tile.rect.x() * sizeof(QRgb),
+                              tile.rect.width(), tile.rect.height(), bytes_per_line, QImage::Format_RGB32);
+
+            QPainter tile_painter(&tile_image);
+            tile_painter.setRenderHints(render_hints);
+
+            RenderContext context(&tile_painter, draw_state_);
+            QTransform device_transform = QTransform::fromTranslate(-tile.rect.x(), -tile.rect.y());
+            TraceRun depth_run("branch", "branch", "depth");
+            for (uint32_t i : tile.instances) {
+                depth_run.step(instances_[i].depth);
+                drawInstance(context, instances_[i], device_transform, tile.render_times_ns);
+            }
+
+            tile_painter.end();
+        });
+    }
+
+    thread_pool_->waitForDone();
+
+    for (const Tile &tile : tiles_) {
+        for (uint depth = 0; depth < num_depths_; depth++) {
+            depth_render_times_ns_[depth] += tile.render_times_ns[depth];
+        }
+    }
+}
+
+void DisplayList::drawSlices(QPainter *painter, const QRect &area, size_t begin, size_t end)
+{
+    if (area.isEmpty() || begin >= end) {
+        return;
+    }
+
+    // split the range into contiguous ranges of roughly the same number of instances
+    size_t num_instances = end - begin;
+    size_t num_slices = std::min<size_t>(thread_pool_->maxThreadCount(), num_instances);
+    slices_.resize(num_slices);
+
+    for (size_t i = 0; i < num_slices; i++) {
+        Slice &slice = slices_[i];
+        slice.begin = begin + num_instances * i / num_slices;
+        slice.end = begin + num_instances * (i + 1) / num_slices;
+        slice.render_times_ns.assign(num_depths_, 0);
+
+        // a layer only has to be as large as the part of the visible area that its instances cover
+        QRectF bounds;
+        for (size_t j = slice.begin; j < slice.end; j++) {
+            bounds = bounds.united(instances_[j].bounds);
+        }
+        slice.rect = bounds.toAlignedRect().adjusted(-kAntialiasingMargin, -kAntialiasingMargin,
+                                                     kAntialiasingMargin, kAntialiasingMargin).intersected(area);
+
+        if (slice.layer.size() != slice.rect.size()) {
+            slice.layer = QImage(slice.rect.size(), QImage::Format_ARGB32_Premultiplied);
+        }
+    }
+
+    QPainter::RenderHints render_hints = painter->renderHints();
+
+    for (Slice &slice : slices_) {
+        if (slice.rect.isEmpty()) {
+            continue;
+        }
+
+        thread_pool_->start([this, &slice, render_hints]() {
+            slice.layer.fill(Qt::transparent);
+
+            QPainter layer_painter(&slice.layer);
+            layer_painter.setRenderHints(render_hints);
+
+            RenderContext context(&layer_painter, draw_state_);
+            QTransform device_transform = QTransform::fromTranslate(-slice.rect.x(), -slice.rect.y());
+            TraceRun depth_run("branch", "branch", "depth");
+            for (size_t i = slice.begin; i < slice.end; i++) {
+                depth_run.step(instances_[i].depth);
+                drawInstance(context, instances_[i], device_transform, slice.render_times_ns);
+            }
+
+            layer_painter.end();
+        });
+    }
+
+    thread_pool_->waitForDone();
+
+    // drawing a layer over the previous ones gives the same result as drawing its instances directly, as long as the layers
+    // are composited in z-order
+    const QTransform painter_transform = painter->worldTransform();
+    painter->setWorldTransform(QTransform(), false);
+
+    for (const Slice &slice : slices_) {
+        if (!slice.rect.isEmpty()) {
+            painter->drawImage(slice.rect.topLeft(), slice.layer);
+        }
+
+        for (uint depth = 0; depth < num_depths_; depth++) {
+            depth_render_times_ns_[depth] += slice.render_times_ns[depth];
+        }
+    }
+
+    painter->setWorldTransform(painter_transform, false);
+}
+
+void DisplayList::drawInstance(RenderContext &context, const LeafInstance &instance, const QTransform &device_transform,
+                               std::vector<uint64_t> &render_times_ns) const
+{
+    std::chrono::steady_clock::time_point drawing_start = std::chrono::steady_clock::now();
+
+    context.painter->setWorldTransform(instance.transform * device_transform, false);
+    instance.leaf->draw(context, instance.depth);
+
+    std::chrono::steady_clock::time_point drawing_end = std::chrono::steady_clock::now();
+    render_times_ns[instance.depth] += std::chrono::duration_cast<std::chrono::nanoseconds>(drawing_end - drawing_start).count();
+
+    if (Tracer::isEnabled()) {
+        Tracer::instance().record(leafTypeName(instance.leaf->getType()), "leaf", drawing_start, drawing_end,
+                                  {"depth", instance.depth}, {"leaf", instance.leaf->getId()});
+    }
+}
+
+void DisplayList::drawSelection(QPainter *painter)
+{
+    if (draw_state_.mode != ctx_mode_t::edit || selected_instances_.empty()) {
+        return;
+    }
+
+    const QTransform painter_transform = painter->worldTransform();
+    RenderContext context(painter, draw_state_);
+
+    for (size_t i : selected_instances_) {
+        const LeafInstance &instance = instances_[i];
+        if (instance.depth != draw_state_.selected_leaf_depth) {
+            continue;
+        }
+
+        painter->setWorldTransform(instance.transform, false);
+        instance.leaf->drawSelection(context);
+    }
+
+    painter->setWorldTransform(painter_transform, false);
+}
+
+void DisplayList::drawColorIds(std::shared_ptr<QPainter> color_id_painter, LeafIdentifier &leaf_identifier, const QRectF &area)
+{
+    const QTransform color_id_painter_transform = color_id_painter->worldTransform();
+    RenderContext context(color_id_painter.get(), draw_state_);
+
+    leaf_identifier.beginPass();
+
+    for (const LeafInstance &instance : instances_) {
+        // only the editable spawn point instance can be selected
+        if (instance.leaf->isSpawnPoint() && instance.depth != 0) {
+            continue;
+        }
+
+        if (area.isValid() && !instance.bounds.intersects(area)) {
+            continue;
+        }
+
+        QColor color = leaf_identifier.registerInstance(instance.leaf->getId(), instance.depth);
+        if (!color.isValid()) {
+            break;
+        }
+
+        color_id_painter->setWorldTransform(instance.transform, false);
+        instance.leaf->drawColorId(context, color);
+    }
+
+    color_id_painter->setWorldTransform(color_id_painter_transform, false);
+}
+
+const LeafInstance * DisplayList::pick(QPointF position) const
+{
+    // the last drawn instance is the topmost one
+    for (auto it = instances_.rbegin(); it != instances_.rend(); it++) {
+        const LeafInstance &instance = *it;
+
+        // only the editable spawn point instance can be selected
+        if (instance.leaf->isSpawnPoint() && instance.depth != 0) {
+            continue;
+        }
+
+        if (!instance.bounds.adjusted(-kPickTolerance, -kPickTolerance, kPickTolerance, kPickTolerance).contains(position)) {
+            continue;
+        }
+
+        bool invertible = false;
+        QTransform inverse = instance.transform.inverted(&invertible);
+        if (!invertible) {
+            continue;
+        }
+
+        // the tolerance is in pixels, so scale it to leaf space
+        qreal tolerance = kPickTolerance / sqrt(fabs(instance.transform.determinant()));
+
+        if (instance.leaf->contains(inverse.map(position), tolerance)) {
+            return &instance;
+        }
+    }
+
+    return nullptr;
+}
+
+void DisplayList::calculateTailBounds(const Branch &branch)
+{
+    has_tail_bounds_ = false;
+
+    Leaf *spawn_point = nullptr;
+
+    for (auto &leaf : branch.leaves()) {
+        if (leaf->isSpawnPoint()) {
+            // with more than one spawn point the number of instances grows exponentially and the simple bound doesn't hold
+            if (spawn_point != nullptr) {
+                return;
+            }
+            spawn_point = leaf.get();
+        }
+    }
+
+    if (spawn_point == nullptr || branch_bounds_.isEmpty()) {
+        return;
+    }
+
+    const QTransform &spawn_transform = spawn_point->matrix();
+    if (!spawn_transform.isAffine() || getMaxScale(spawn_transform) >= 1) {
+        return;
+    }
+
+    // the spawn transformation is a contraction, so it brings every point closer to its fixed point: a point of a branch
+    // instance at distance r from it is at most r * scale^n away after n spawns. Thus a disc around the fixed point that
+    // contains one branch instance also contains all instances spawned by it.
+    QPointF fixed_point;
+    if (!getFixedPoint(spawn_transform, fixed_point)) {
+        return;
+    }
+
+    qreal radius = 0;
+    for (const QPointF &corner : {branch_bounds_.topLeft(), branch_bounds_.topRight(), branch_bounds_.bottomLeft(), branch_bounds_.bottomRight()}) {
+        radius = fmax(radius, getPointDistance(fixed_point, corner));
+    }
+
+    tail_bounds_ = QRectF(fixed_point.x() - radius, fixed_point.y() - radius, 2 * radius, 2 * radius);
+    has_tail_bounds_ = true;
+}
+
+void DisplayList::addInstance(const LeafInstance &instance)
+{
+    if (instance.leaf->isSelected()) {
+        selected_instances_.push_back(instances_.size());
+    }
+
+    instances_.push_back(instance);
+}
+
+bool DisplayList::isCulled(const QRectF &bounds, const QRectF &visible_area)
+{
+    if (bounds.width() < kMinInstanceSize && bounds.height() < kMinInstanceSize) {
+        return true;
+    }
+
+    return !bounds.intersects(visible_area.adjusted(-kAntialiasingMargin, -kAntialiasingMargin, kAntialiasingMargin, kAntialiasingMargin));
+}
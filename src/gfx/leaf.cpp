@@ -11,13 +11,18 @@
 #include "gfx/leaves/spawnpoint.h"
 #include "rgf_ctx.h"
 
+const QPen Leaf::kSelectionPen = QPen(QColor(0, 0, 0, 255));
+
+const QPen Leaf::kNoOutlinePen = QPen(Qt::NoPen);
+
 Leaf::Leaf(std::weak_ptr<RgfCtx> ctx, leaf_type_t type) :
     ctx_(ctx),
-    color_id_(QColor(255, 255, 255)),
+    id_(LeafIdentifier::kInvalidLeafId),
     selected_(false),
     controls_({}),
     type_(type),
-    matrix_(QTransform())
+    matrix_(QTransform()),
+    revision_(nextRevision())
 {
 }
 
@@ -51,36 +56,26 @@ void Leaf::insertType(QMimeData *mime_data, leaf_type_t type)
 }
 
 
-void Leaf::draw(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter, uint depth)
+void Leaf::drawSelection(RenderContext &context)
 {
-    std::shared_ptr<RgfCtx> ctx_p = ctx_.lock();
-
-    if (ctx_p == nullptr)
-        return;
-
-    if (!matrix_.isIdentity()) {
-        // combine param is true, so combine matrix_ with the existing transformations instead of overwriting them
-        painter->setWorldTransform(matrix_, true);
-        color_id_painter->setWorldTransform(matrix_, true);
-    }
-
-    // TODO: draw the transformation matrix on top of its respective shape, not below it
-    if (ctx_p->getMode() != RgfCtx::mode_t::edit || !selected_ || ctx_p->getSelectedLeafDepth() != depth)
-        return;
-
-    // in principle the side should be 1, but 1 pixel is too short of a length
-    const uint side = 30;
+    const qreal side = kSelectionMatrixSide;
 
     // draw the transformation matrix
-    painter->setPen(QColor(128, 128, 128, 64));
-    painter->drawLine(side, 0, side, side);
-    painter->drawLine(0, side, side, side);
+    context.setPen(QColor(128, 128, 128, 64));
+    context.painter->drawLine(side, 0, side, side);
+    context.painter->drawLine(0, side, side, side);
 
-    painter->setPen(QColor(255, 0, 0, 64));
-    painter->drawLine(0, side, 0, 0);
+    context.setPen(QColor(255, 0, 0, 64));
+    context.painter->drawLine(0, side, 0, 0);
 
-    painter->setPen(QColor(0, 0, 255, 64));
-    painter->drawLine(side, 0, 0, 0);
+    context.setPen(QColor(0, 0, 255, 64));
+    context.painter->drawLine(side, 0, 0, 0);
+}
+
+QRectF Leaf::getSelectionBoundingRect()
+{
+    return QRectF(0, 0, kSelectionMatrixSide, kSelectionMatrixSide).adjusted(-kOutlineMargin, -kOutlineMargin,
+                                                                              kOutlineMargin, kOutlineMargin);
 }
 
 void Leaf::drawDragged(std::shared_ptr<QPainter> painter, leaf_type_t leaf_type, QPointF position, qreal scale)
@@ -126,7 +121,7 @@ std::shared_ptr<Leaf> Leaf::constructNew(std::shared_ptr<RgfCtx> ctx, leaf_type_
         assert(0 && "Invalid leaf type passed!");
     }
 
-    leaf->color_id_ = ctx->leafIdentifier()->registerLeaf(leaf);
+    leaf->id_ = ctx->leafIdentifier()->registerLeaf(leaf);
 
     return leaf;
 }
@@ -137,17 +132,23 @@ bool Leaf::setTransformationMatrix(QTransform matrix)
         return false;
 
     matrix_ = matrix;
+    markModified();
     return true;
 }
 
 void Leaf::select()
 {
     selected_ = true;
+    markModified();
     createControls();
 }
 
 void Leaf::deselect()
 {
+    if (selected_) {
+        markModified();
+    }
+
     selected_ = false;
     destroyControls();
 }
@@ -172,24 +173,21 @@ QPointF Leaf::fromSreenSpace(std::shared_ptr<RgfCtx> ctx, QPointF coordinate)
 void Leaf::translateNatively(QPointF translation)
 {
     matrix_.translate(translation.x(), translation.y());
+    markModified();
     emit transformedNatively();
 }
 
-QColor Leaf::getUniqueColor(uint depth)
+void Leaf::destroyControls()
 {
-    QColor result = color_id_;
-
-    // sanity verification
-    depth &= 0x3FF;
-
-    result.setRgb(result.rgb() | depth);
-
-    return result;
+    controls_.clear();
 }
 
-void Leaf::destroyControls()
+void Leaf::copyTo(Leaf &clone) const
 {
-    controls_.clear();
+    clone.id_ = id_;
+    clone.selected_ = selected_;
+    clone.matrix_ = matrix_;
+    clone.revision_ = revision_;
 }
 
 void Leaf::drawControls(std::shared_ptr<QPainter> painter)
@@ -10,7 +10,8 @@
 Circle::Circle(std::weak_ptr<RgfCtx> ctx, qreal radius, QColor color) :
     Leaf {ctx, leaf_type_t::circle},
     radius_(abs(radius)),
-    color_(color)
+    color_(color),
+    brush_(color)
 {
 
 }
@@ -34,36 +35,48 @@ std::shared_ptr<Circle> Circle::constructNew(std::weak_ptr<RgfCtx> ctx)
     return std::make_shared<CircleCtor>(ctx_p, kDefaultRadius, Qt::red);
 }
 
-void Circle::draw(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter, uint depth)
+std::shared_ptr<Leaf> Circle::clone() const
 {
-    std::shared_ptr<RgfCtx> ctx_p = ctx_.lock();
-
-    if (ctx_p == nullptr)
-        return;
-
-    Leaf::draw(painter, color_id_painter, depth);
-
-    if (selected_ &&
-        ctx_p->getMode() == RgfCtx::mode_t::edit &&
-        ctx_p->getSelectedLeafDepth() == depth) {
-        painter->setPen(QColor(0, 0, 0, 255));
-    } else {
-        painter->setPen(QColor(0, 0, 0, 0));
-    }
-    painter->setBrush(color_);
-
-    // TODO: don't draw a circle (or any graphics for that matter) if it's going to be less than 1 pixel wide in any dimension
-    // TODO: don't draw a circle (or any graphics for that matter) if it's going to be outside the view area
-    painter->drawEllipse(QRectF(-radius_, -radius_, radius_ * 2, radius_ * 2));
-
-    if (ctx_p->getMode() == RgfCtx::mode_t::edit) {
-        color_id_painter->setBrush(getUniqueColor(depth));
-        color_id_painter->setPen(QColor(0, 0, 0, 0));
-        color_id_painter->drawEllipse(QRectF(-radius_, -radius_, radius_ * 2, radius_ * 2));
-    }
-
-    unapplyLocalTransformations(painter);
-    unapplyLocalTransformations(color_id_painter);
+    // a plain new, since the ctor is private
+    std::shared_ptr<Circle> circle(new Circle(ctx_, radius_, color_));
+    copyTo(*circle);
+
+    return circle;
+}
+
+void Circle::draw(RenderContext &context, uint depth)
+{
+    context.setPen(kNoOutlinePen);
+    context.setBrush(brush_);
+
+    context.painter->drawEllipse(QRectF(-radius_, -radius_, radius_ * 2, radius_ * 2));
+}
+
+void Circle::drawSelection(RenderContext &context)
+{
+    context.setPen(kSelectionPen);
+    context.setBrush(Qt::NoBrush);
+
+    context.painter->drawEllipse(QRectF(-radius_, -radius_, radius_ * 2, radius_ * 2));
+
+    Leaf::drawSelection(context);
+}
+
+void Circle::drawColorId(RenderContext &context, QColor color)
+{
+    context.setBrush(color);
+    context.setPen(kNoOutlinePen);
+    context.painter->drawEllipse(QRectF(-radius_, -radius_, radius_ * 2, radius_ * 2));
+}
+
+QRectF Circle::getBoundingRect() const
+{
+    return QRectF(-radius_, -radius_, radius_ * 2, radius_ * 2).adjusted(-kOutlineMargin, -kOutlineMargin, kOutlineMargin, kOutlineMargin);
+}
+
+bool Circle::contains(QPointF point, qreal tolerance) const
+{
+    return point.x() * point.x() + point.y() * point.y() <= radius_ * radius_;
 }
 
 void Circle::drawDragged(std::shared_ptr<QPainter> painter, QPointF position, qreal scale)
@@ -2,6 +2,7 @@
 // Distributed under GPL-3.0
 // Copyright (C) 2023-2024  Vesko Milev
 
+#include <algorithm>
 #include <QTransform>
 #include <QPainterPath>
 
@@ -10,10 +11,13 @@
 #include "math_utils.h"
 #include "rgf_ctx.h"
 
+const QPen Line::kLineSelectionPen = QPen(QBrush(QColor(0, 0, 0, 255)), 2);
+
 Line::Line(std::weak_ptr<RgfCtx> ctx, QLineF line, QColor color) :
     Leaf {ctx, leaf_type_t::line},
     line_(line),
-    color_(color)
+    color_(color),
+    pen_(color)
 {
 
 }
@@ -37,53 +41,63 @@ std::shared_ptr<Line> Line::constructNew(std::weak_ptr<RgfCtx> ctx)
     return std::make_shared<LineCtor>(ctx_p, kDefaultLine, Qt::red);
 }
 
-void Line::draw(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter, uint depth)
+std::shared_ptr<Leaf> Line::clone() const
 {
-    std::shared_ptr<RgfCtx> ctx_p = ctx_.lock();
+    // a plain new, since the ctor is private
+    std::shared_ptr<Line> line(new Line(ctx_, line_, color_));
+    copyTo(*line);
 
-    if (ctx_p == nullptr)
-        return;
+    return line;
+}
 
+void Line::draw(RenderContext &context, uint depth)
+{
+    context.setPen(pen_);
 
-    Leaf::draw(painter, color_id_painter, depth);
+    context.painter->drawLine(line_);
+}
 
-    // draw just the outline
-    if (selected_ &&
-        ctx_p->getMode() == RgfCtx::mode_t::edit &&
-        ctx_p->getSelectedLeafDepth() == depth) {
-        QPen pen(QColor(0, 0, 0, 255));
-        pen.setWidth(2);
-        painter->setPen(pen);
+void Line::drawSelection(RenderContext &context)
+{
+    // the outline is wider than the line, so the line is drawn again over it, in its own color
+    context.setPen(kLineSelectionPen);
+    context.painter->drawLine(line_);
 
-        painter->drawLine(line_);
-    }
+    context.setPen(pen_);
+    context.painter->drawLine(line_);
 
-    // reset pen width
-    QPen pen(color_);
-    pen.setWidth(1);
-    painter->setPen(pen);
+    Leaf::drawSelection(context);
+}
 
-    painter->drawLine(line_);
+void Line::drawColorId(RenderContext &context, QColor color)
+{
+    QPen pen(color);
+    pen.setWidth(getColorIdPenWidth(context.state.view_scale));
 
-    if (ctx_p->getMode() == RgfCtx::mode_t::edit) {
+    context.setPen(pen);
+    context.painter->drawLine(line_);
+}
 
-        QPen pen(getUniqueColor(depth));
-        pen.setWidth(1 +
-                     4.0 /
-                             (decomposeMatrix(matrix()).avg_scale *
-                                ctx_p->getView().scale)
-                     ); // make lines easier to select by scaling up color id area if user view lines are too thin to easily select
+QRectF Line::getBoundingRect() const
+{
+    return QRectF(line_.p1(), line_.p2()).normalized().adjusted(-kOutlineMargin, -kOutlineMargin, kOutlineMargin, kOutlineMargin);
+}
 
-        color_id_painter->setPen(pen);
-        color_id_painter->drawLine(line_);
+QRectF Line::getColorIdBoundingRect(qreal view_scale) const
+{
+    qreal margin = std::max(kOutlineMargin, getColorIdPenWidth(view_scale) / 2);
+    return QRectF(line_.p1(), line_.p2()).normalized().adjusted(-margin, -margin, margin, margin);
+}
 
-        // reset pen width
-        pen.setWidth(1);
-        color_id_painter->setPen(pen);
-    }
+qreal Line::getColorIdPenWidth(qreal view_scale) const
+{
+    // make lines easier to select by scaling up color id area if user view lines are too thin to easily select
+    return 1 + 4.0 / (decomposeMatrix(matrix()).avg_scale * view_scale);
+}
 
-    unapplyLocalTransformations(painter);
-    unapplyLocalTransformations(color_id_painter);
+bool Line::contains(QPointF point, qreal tolerance) const
+{
+    return getPointToSegmentDistance(point, line_.p1(), line_.p2()) <= tolerance;
 }
 
 void Line::drawDragged(std::shared_ptr<QPainter> painter, QPointF position, qreal scale)
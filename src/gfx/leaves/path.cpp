@@ -2,17 +2,17 @@
 // Distributed under GPL-3.0
 // Copyright (C) 20232-2024  Vesko Milev
 
-#include <QPainterPath>
-
 #include "controls/path_control.h"
 #include "gfx/leaves/path.h"
+#include "math_utils.h"
 #include "rgf_ctx.h"
 
 const std::vector<QPointF> Path::kDefaultPoints = {QPointF(0.0f, -20.0f), QPointF(20.0f, 20.0f), QPointF(-20.0f, 20.0f)};
 
 Path::Path(std::weak_ptr<RgfCtx> ctx, QColor color) :
     Leaf {ctx, leaf_type_t::path},
-    color_(color)
+    color_(color),
+    brush_(color)
 {
 
 }
@@ -43,44 +43,78 @@ std::shared_ptr<Path> Path::constructNew(std::weak_ptr<RgfCtx> ctx)
     return path;
 }
 
-void Path::draw(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter, uint depth)
+std::shared_ptr<Leaf> Path::clone() const
 {
-    std::shared_ptr<RgfCtx> ctx_p = ctx_.lock();
+    // a plain new, since the ctor is private
+    std::shared_ptr<Path> path(new Path(ctx_, color_));
+    path->points_ = points_;
+    copyTo(*path);
 
-    if (ctx_p == nullptr)
-        return;
+    return path;
+}
 
+void Path::draw(RenderContext &context, uint depth)
+{
+    if (points_.size() > 0) {
+        context.setPen(kNoOutlinePen);
+        context.setBrush(brush_);
+        drawPolygon(context.painter);
+    }
+}
 
-    Leaf::draw(painter, color_id_painter, depth);
+void Path::drawSelection(RenderContext &context)
+{
+    if (points_.size() > 0) {
+        context.setPen(kSelectionPen);
+        context.setBrush(Qt::NoBrush);
+        drawPolygon(context.painter);
+    }
 
+    Leaf::drawSelection(context);
+}
+
+void Path::drawColorId(RenderContext &context, QColor color)
+{
     if (points_.size() > 0) {
-        QPainterPath path(points_[0]);
-
-        for (QPointF& point : points_) {
-            path.lineTo(point);
-        }
-
-        path.closeSubpath();
-
-        if (selected_ &&
-            ctx_p->getMode() == RgfCtx::mode_t::edit &&
-            ctx_p->getSelectedLeafDepth() == depth) {
-            painter->setPen(QColor(0, 0, 0, 255));
-        } else {
-            painter->setPen(QColor(0, 0, 0, 0));
-        }
-        painter->setBrush(color_);
-        painter->drawPath(path);
-
-        if (ctx_p->getMode() == RgfCtx::mode_t::edit) {
-            color_id_painter->setPen(QColor(0, 0, 0, 0));
-            color_id_painter->setBrush(getUniqueColor(depth));
-            color_id_painter->drawPath(path);
-        }
+        context.setPen(kNoOutlinePen);
+        context.setBrush(color);
+        drawPolygon(context.painter);
+    }
+}
+
+void Path::drawPolygon(QPainter *painter) const
+{
+    // the vertices are drawn as they're stored, so nothing is built per instance; the odd-even fill rule is the same that a
+    // closed QPainterPath of them is filled with
+    painter->drawPolygon(points_.data(), points_.size(), Qt::OddEvenFill);
+}
+
+QRectF Path::getBoundingRect() const
+{
+    if (points_.size() == 0) {
+        return QRectF();
+    }
+
+    QPointF top_left = points_[0];
+    QPointF bottom_right = points_[0];
+
+    for (const QPointF& point : points_) {
+        top_left.rx() = fmin(top_left.x(), point.x());
+        top_left.ry() = fmin(top_left.y(), point.y());
+        bottom_right.rx() = fmax(bottom_right.x(), point.x());
+        bottom_right.ry() = fmax(bottom_right.y(), point.y());
     }
 
-    unapplyLocalTransformations(painter);
-    unapplyLocalTransformations(color_id_painter);
+    return QRectF(top_left, bottom_right).adjusted(-kOutlineMargin, -kOutlineMargin, kOutlineMargin, kOutlineMargin);
+}
+
+bool Path::contains(QPointF point, qreal tolerance) const
+{
+    if (points_.size() == 0) {
+        return false;
+    }
+
+    return isPointInPolygon(point, points_);
 }
 
 void Path::drawDragged(std::shared_ptr<QPainter> painter, QPointF position, qreal scale)
@@ -93,12 +127,7 @@ void Path::drawDragged(std::shared_ptr<QPainter> painter, QPointF position, qrea
     t.translate(position.rx(), position.ry());
     painter->setWorldTransform(t, true);
 
-    QPainterPath path(kDefaultPoints[0]);
-    for (const QPointF& point : kDefaultPoints) {
-        path.lineTo(point);
-    }
-    path.closeSubpath();
-    painter->drawPath(path);
+    painter->drawPolygon(kDefaultPoints.data(), kDefaultPoints.size());
 
     painter->setWorldTransform(t.inverted(), true);
 }
@@ -106,6 +135,25 @@ void Path::drawDragged(std::shared_ptr<QPainter> painter, QPointF position, qrea
 void Path::addPoint(QPointF point)
 {
     points_.push_back(point);
+    markModified();
+}
+
+void Path::insertPoint(size_t index, QPointF point)
+{
+    points_.insert(points_.begin() + index, point);
+    markModified();
+}
+
+void Path::removePoint(size_t index)
+{
+    points_.erase(points_.begin() + index);
+    markModified();
+}
+
+void Path::movePoint(size_t index, QPointF delta)
+{
+    points_[index] += delta;
+    markModified();
 }
 
 void Path::select()
@@ -10,7 +10,8 @@
 Rectangle::Rectangle(std::weak_ptr<RgfCtx> ctx, QRectF rectangle, QColor color) :
     Leaf {ctx, leaf_type_t::rectangle},
     rectangle_(rectangle),
-    color_(color)
+    color_(color),
+    brush_(color)
 {
 
 }
@@ -34,34 +35,46 @@ std::shared_ptr<Rectangle> Rectangle::constructNew(std::weak_ptr<RgfCtx> ctx)
     return std::make_shared<RectangleCtor>(ctx_p, kDefaultRectangle, Qt::red);
 }
 
-void Rectangle::draw(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter, uint depth)
+std::shared_ptr<Leaf> Rectangle::clone() const
 {
-    std::shared_ptr<RgfCtx> ctx_p = ctx_.lock();
+    // a plain new, since the ctor is private
+    std::shared_ptr<Rectangle> rectangle(new Rectangle(ctx_, rectangle_, color_));
+    copyTo(*rectangle);
 
-    if (ctx_p == nullptr)
-        return;
+    return rectangle;
+}
 
+void Rectangle::draw(RenderContext &context, uint depth)
+{
+    context.setPen(kNoOutlinePen);
+    context.setBrush(brush_);
+    context.painter->drawRect(rectangle_);
+}
 
-    Leaf::draw(painter, color_id_painter, depth);
+void Rectangle::drawSelection(RenderContext &context)
+{
+    context.setPen(kSelectionPen);
+    context.setBrush(Qt::NoBrush);
+    context.painter->drawRect(rectangle_);
 
-    if (selected_ &&
-        ctx_p->getMode() == RgfCtx::mode_t::edit &&
-        ctx_p->getSelectedLeafDepth() == depth) {
-        painter->setPen(QColor(0, 0, 0, 255));
-    } else {
-        painter->setPen(QColor(0, 0, 0, 0));
-    }
-    painter->setBrush(color_);
-    painter->drawRect(rectangle_);
+    Leaf::drawSelection(context);
+}
 
-    if (ctx_p->getMode() == RgfCtx::mode_t::edit) {
-        color_id_painter->setPen(QColor(0, 0, 0, 0));
-        color_id_painter->setBrush(getUniqueColor(depth));
-        color_id_painter->drawRect(rectangle_);
-    }
+void Rectangle::drawColorId(RenderContext &context, QColor color)
+{
+    context.setPen(kNoOutlinePen);
+    context.setBrush(color);
+    context.painter->drawRect(rectangle_);
+}
 
-    unapplyLocalTransformations(painter);
-    unapplyLocalTransformations(color_id_painter);
+QRectF Rectangle::getBoundingRect() const
+{
+    return rectangle_.normalized().adjusted(-kOutlineMargin, -kOutlineMargin, kOutlineMargin, kOutlineMargin);
+}
+
+bool Rectangle::contains(QPointF point, qreal tolerance) const
+{
+    return rectangle_.normalized().contains(point);
 }
 
 void Rectangle::drawDragged(std::shared_ptr<QPainter> painter, QPointF position, qreal scale)
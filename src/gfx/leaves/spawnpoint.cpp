@@ -5,6 +5,10 @@
 #include "gfx/leaves/spawnpoint.h"
 #include "rgf_ctx.h"
 
+const QPen SpawnPoint::kEditablePen = QPen(QColor(100, 0, 0, 160));
+
+const QPen SpawnPoint::kSpawnedPen = QPen(QColor(0, 0, 0, 128));
+
 SpawnPoint::SpawnPoint(std::weak_ptr<RgfCtx> ctx) :
     Leaf {ctx, leaf_type_t::spawn_point}
 {
@@ -24,45 +28,65 @@ std::shared_ptr<SpawnPoint> SpawnPoint::constructNew(std::weak_ptr<RgfCtx> ctx)
     return std::make_shared<SpawnPointCtor>(ctx_p);
 }
 
-SpawnPoint::~SpawnPoint()
+std::shared_ptr<Leaf> SpawnPoint::clone() const
 {
+    // a plain new, since the ctor is private
+    std::shared_ptr<SpawnPoint> spawn_point(new SpawnPoint(ctx_));
+    copyTo(*spawn_point);
+
+    return spawn_point;
 }
 
-void SpawnPoint::draw(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter, uint depth)
+SpawnPoint::~SpawnPoint()
 {
-    Leaf::draw(painter, color_id_painter, depth);
-
-    std::shared_ptr<RgfCtx> ctx_p = ctx_.lock();
-    if (ctx_p == nullptr)
-        return;
+}
 
+void SpawnPoint::draw(RenderContext &context, uint depth)
+{
     // don't draw spawn points in view mode
-    if (ctx_p->getMode() == RgfCtx::mode_t::view)
+    if (context.state.mode == ctx_mode_t::view)
         return;
 
-    painter->setBrush(Qt::transparent);
+    context.setBrush(Qt::NoBrush);
 
     // only highlight the editable spawn point instance, so as not to clutter the viewport
     bool editable = (depth == 0);
 
     if (editable) {
-        painter->setPen(QColor(100, 0, 0, 160));
-        painter->drawEllipse(QPointF(0, 0), 3, 3);
+        context.setPen(kEditablePen);
+        context.painter->drawEllipse(QPointF(0, 0), 3, 3);
     } else {
-        painter->setPen(QColor(0, 0, 0, 128));
-        painter->drawEllipse(QPointF(0, 0), 2, 2);
+        context.setPen(kSpawnedPen);
+        context.painter->drawEllipse(QPointF(0, 0), 2, 2);
     }
+}
 
-    if (selected_ && ctx_p->getMode() == RgfCtx::mode_t::edit && editable) {
-        painter->setPen(QColor(0, 0, 0, 255));
-        painter->drawEllipse(QPointF(0, 0), 4, 4);
-    }
+void SpawnPoint::drawSelection(RenderContext &context)
+{
+    // only the editable instance can be selected, so the outline goes around its circle
+    context.setBrush(Qt::NoBrush);
+    context.setPen(kSelectionPen);
+    context.painter->drawEllipse(QPointF(0, 0), 4, 4);
 
-    if (ctx_p->getMode() == RgfCtx::mode_t::edit && editable) {
-        color_id_painter->setBrush(getUniqueColor(depth));
-        color_id_painter->setPen(QColor(0, 0, 0, 0));
-        color_id_painter->drawEllipse(QPointF(0, 0), 3, 3);
-    }
+    Leaf::drawSelection(context);
+}
+
+void SpawnPoint::drawColorId(RenderContext &context, QColor color)
+{
+    context.setBrush(color);
+    context.setPen(kNoOutlinePen);
+    context.painter->drawEllipse(QPointF(0, 0), kSelectableRadius, kSelectableRadius);
+}
+
+QRectF SpawnPoint::getBoundingRect() const
+{
+    // the selection outline is the largest of the drawn circles
+    return QRectF(-4, -4, 8, 8).adjusted(-kOutlineMargin, -kOutlineMargin, kOutlineMargin, kOutlineMargin);
+}
+
+bool SpawnPoint::contains(QPointF point, qreal tolerance) const
+{
+    return point.x() * point.x() + point.y() * point.y() <= kSelectableRadius * kSelectableRadius;
 }
 
 void SpawnPoint::createControls()
@@ -0,0 +1,59 @@
+// Regrafusion - draws graphics recursively
+// Distributed under GPL-3.0
+// Copyright (C) 2024  Vesko Milev
+
+#include "gfx/spawn_transformation_table.h"
+
+SpawnTransformationTable::SpawnTransformationTable() :
+    spawn_transformation_(QTransform()),
+    powers_({{QTransform()}, {}}),
+    inverse_powers_({{QTransform()}, {}})
+{
+}
+
+const QTransform& SpawnTransformationTable::power(const QTransform &spawn_transformation, uint depth)
+{
+    update(spawn_transformation);
+    return lookUp(powers_, depth);
+}
+
+const QTransform& SpawnTransformationTable::inversePower(const QTransform &spawn_transformation, uint depth)
+{
+    update(spawn_transformation);
+    return lookUp(inverse_powers_, depth);
+}
+
+void SpawnTransformationTable::update(const QTransform &spawn_transformation)
+{
+    if (spawn_transformation == spawn_transformation_) {
+        return;
+    }
+
+    spawn_transformation_ = spawn_transformation;
+
+    // leaf matrices are always invertible
+    powers_ = {{spawn_transformation}, {}};
+    inverse_powers_ = {{spawn_transformation.inverted()}, {}};
+}
+
+const QTransform& SpawnTransformationTable::lookUp(Powers &powers, uint exponent)
+{
+    auto it = powers.powers.find(exponent);
+    if (it != powers.powers.end()) {
+        return it->second;
+    }
+
+    // all powers are of the same transformation, so they commute and can be multiplied in any order
+    QTransform power;
+    for (uint bit = 0; (exponent >> bit) != 0; bit++) {
+        if (bit == powers.squares.size()) {
+            powers.squares.push_back(powers.squares.back() * powers.squares.back());
+        }
+
+        if ((exponent >> bit) & 1) {
+            power *= powers.squares[bit];
+        }
+    }
+
+    return powers.powers.emplace(exponent, power).first->second;
+}
@@ -2,53 +2,193 @@
 // Distributed under GPL-3.0
 // Copyright (C) 2023-2024  Vesko Milev
 
+#include <algorithm>
 #include <chrono>
 
+#include "allocation_counter.h"
 #include "common.h"
 #include "gfx/tree.h"
+#include "rgf_ctx.h"
+#include "trace.h"
 
 Tree::Tree(std::weak_ptr<RgfCtx> ctx, uint num_branches_to_draw) :
-    ctx_(ctx),
-    num_branches_to_draw_(num_branches_to_draw)
+    Tree(ctx, num_branches_to_draw, {})
 {
     branches_.push_back(std::make_unique<Branch>(ctx_));
 }
 
-TreeStatistics& Tree::draw(std::shared_ptr<QPainter> painter, std::shared_ptr<QPainter> color_id_painter)
+Tree::Tree(std::weak_ptr<RgfCtx> ctx, uint num_branches_to_draw, std::vector<std::unique_ptr<Branch>> branches) :
+    ctx_(ctx),
+    branches_(std::move(branches)),
+    num_branches_to_draw_(num_branches_to_draw),
+    adaptive_depth_(false),
+    adaptive_depth_threshold_px_(kDefaultAdaptiveDepthThreshold),
+    revision_(nextRevision()),
+    stats_(),
+    incremental_render_time_(0),
+    incremental_allocation_count_(0)
+{
+}
+
+TreeStatistics& Tree::draw(std::shared_ptr<QPainter> painter, const QRectF &visible_area, const LeafDrawState &draw_state,
+                           std::shared_ptr<QPainter> color_id_painter)
 {
-    BranchStatistics branch_stats;
-    branch_stats.num_branches = num_branches_to_draw_;
+    TraceZone zone("Tree::draw", "tree");
+
+    BranchStatistics branch_stats = {0, 0, 0, num_branches_to_draw_};
 
     std::chrono::steady_clock::time_point drawing_start = std::chrono::steady_clock::now();
+    uint64_t allocation_count = allocationCount();
 
-    for (auto &branch : branches_) {
-        branch->draw(painter, color_id_painter, num_branches_to_draw_, branch_stats, 0);
+    display_list_.compile(branches_, num_branches_to_draw_, painter->worldTransform(), visible_area, draw_state,
+                          adaptive_depth_ ? adaptive_depth_threshold_px_ : 0);
+
+    std::shared_ptr<RgfCtx> ctx_p = color_id_painter != nullptr ? ctx_.lock() : nullptr;
+    if (ctx_p != nullptr) {
+        display_list_.draw(painter, draw_state, branch_stats, color_id_painter, ctx_p->leafIdentifier().get());
+    } else {
+        display_list_.draw(painter, draw_state, branch_stats);
     }
 
     std::chrono::steady_clock::time_point drawing_end = std::chrono::steady_clock::now();
 
-    stats_.render_time_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(drawing_end - drawing_start).count());
-    stats_.first_branch_render_time_us.push_back(branch_stats.first_branch_render_time_us);
-    stats_.last_branch_render_time_us.push_back(branch_stats.last_branch_render_time_us);
-    stats_.avg_branch_render_time_us.push_back(vector_average<uint>(branch_stats.branch_render_times_us));
+    recordStatistics(branch_stats, drawing_end - drawing_start, allocationCount() - allocation_count);
+
+    return stats_;
+}
+
+void Tree::beginDraw(std::shared_ptr<QPainter> painter, const QRectF &visible_area, const LeafDrawState &draw_state,
+                     const QRegion &drawn_area)
+{
+    TraceZone zone("Tree::beginDraw", "tree");
+
+    std::chrono::steady_clock::time_point compiling_start = std::chrono::steady_clock::now();
+    incremental_allocation_count_ = allocationCount();
+
+    display_list_.compile(branches_, num_branches_to_draw_, painter->worldTransform(), visible_area, draw_state,
+                          adaptive_depth_ ? adaptive_depth_threshold_px_ : 0);
+    display_list_.beginDraw(draw_state, drawn_area);
+
+    incremental_render_time_ = std::chrono::steady_clock::now() - compiling_start;
+}
+
+bool Tree::drawNext(std::shared_ptr<QPainter> painter, std::chrono::nanoseconds budget)
+{
+    TraceZone zone("Tree::drawNext", "tree");
+
+    std::chrono::steady_clock::time_point drawing_start = std::chrono::steady_clock::now();
+
+    bool finished = display_list_.drawNext(painter, budget);
 
-    if (stats_.render_time_us.size() > kMaxStatsSampleSize) {
-        stats_.render_time_us.erase(stats_.render_time_us.begin());
+    incremental_render_time_ += std::chrono::steady_clock::now() - drawing_start;
+
+    if (finished) {
+        BranchStatistics branch_stats = {0, 0, 0, num_branches_to_draw_};
+        display_list_.getStatistics(branch_stats);
+        recordStatistics(branch_stats, incremental_render_time_, allocationCount() - incremental_allocation_count_);
     }
 
-    if (stats_.first_branch_render_time_us.size() > kMaxStatsSampleSize) {
-        stats_.first_branch_render_time_us.erase(stats_.first_branch_render_time_us.begin());
+    return finished;
+}
+
+void Tree::recordStatistics(const BranchStatistics &branch_stats, std::chrono::steady_clock::duration render_time,
+                            uint64_t allocations)
+{
+    stats_.render_time_us.push(std::chrono::duration_cast<std::chrono::microseconds>(render_time).count());
+    stats_.first_branch_render_time_us.push(branch_stats.first_branch_render_time_us);
+    stats_.last_branch_render_time_us.push(branch_stats.last_branch_render_time_us);
+    stats_.avg_branch_render_time_us.push(branch_stats.avg_branch_render_time_us);
+    stats_.allocations.push(allocations);
+    stats_.effective_depth = display_list_.getEffectiveDepth();
+}
+
+void Tree::recordBackgroundStatistics(std::chrono::steady_clock::duration render_time)
+{
+    stats_.background_render_time_us.push(std::chrono::duration_cast<std::chrono::microseconds>(render_time).count());
+}
+
+std::shared_ptr<Tree> Tree::snapshot() const
+{
+    std::vector<std::unique_ptr<Branch>> branches;
+    for (const auto &branch : branches_) {
+        branches.push_back(branch->clone());
     }
 
-    if (stats_.last_branch_render_time_us.size() > kMaxStatsSampleSize) {
-        stats_.last_branch_render_time_us.erase(stats_.last_branch_render_time_us.begin());
+    // a plain new, since the ctor is private
+    std::shared_ptr<Tree> tree(new Tree(ctx_, num_branches_to_draw_, std::move(branches)));
+
+    tree->adaptive_depth_ = adaptive_depth_;
+    tree->adaptive_depth_threshold_px_ = adaptive_depth_threshold_px_;
+    tree->revision_ = revision_;
+    tree->stats_ = stats_;
+
+    return tree;
+}
+
+void Tree::drawColorIds(std::shared_ptr<QPainter> color_id_painter, LeafIdentifier &leaf_identifier, const QRectF &area)
+{
+    display_list_.drawColorIds(color_id_painter, leaf_identifier, area);
+}
+
+std::shared_ptr<Leaf> Tree::getLeaf(QPointF position, uint &leaf_depth)
+{
+    leaf_depth = 0;
+
+    const LeafInstance *instance = display_list_.pick(position);
+    if (instance == nullptr) {
+        return nullptr;
+    }
+
+    std::shared_ptr<RgfCtx> ctx_p = ctx_.lock();
+    if (ctx_p == nullptr) {
+        return nullptr;
     }
 
-    if (stats_.avg_branch_render_time_us.size() > kMaxStatsSampleSize) {
-        stats_.avg_branch_render_time_us.erase(stats_.avg_branch_render_time_us.begin());
+    // instances don't own their leaves, so look up the owning pointer
+    std::shared_ptr<Leaf> leaf = ctx_p->leafIdentifier()->getLeaf(instance->leaf->getId());
+    if (leaf != nullptr) {
+        leaf_depth = instance->depth;
     }
 
-    return stats_;
+    return leaf;
+}
+
+void Tree::setNumBranches(uint num_branches)
+{
+    // the slider and the spin box set each other, so the same value is often set twice
+    if (num_branches == num_branches_to_draw_)
+        return;
+
+    num_branches_to_draw_ = num_branches;
+    revision_ = nextRevision();
+}
+
+void Tree::setAdaptiveDepth(bool enabled)
+{
+    if (enabled == adaptive_depth_)
+        return;
+
+    adaptive_depth_ = enabled;
+    revision_ = nextRevision();
+}
+
+void Tree::setAdaptiveDepthThreshold(qreal threshold_px)
+{
+    if (threshold_px == adaptive_depth_threshold_px_)
+        return;
+
+    adaptive_depth_threshold_px_ = threshold_px;
+    revision_ = nextRevision();
+}
+
+uint64_t Tree::getRevision() const
+{
+    uint64_t revision = revision_;
+    for (const auto &branch : branches_) {
+        revision = std::max(revision, branch->getRevision());
+    }
+
+    return revision;
 }
 
 void Tree::deselect()
@@ -68,6 +208,26 @@ QTransform Tree::getSpawnPointTransformation()
     return branches_[0]->getSpawnPointTransformation();
 }
 
+bool Tree::setSpawnPointTransformation(QTransform transformation)
+{
+    if (branches_.size() == 0) {
+        return false;
+    }
+
+    assert(branches_.size() == 1 && "Only a tree with a single branch has a single spawn point to set");
+    return branches_[0]->setSpawnPointTransformation(transformation);
+}
+
+QTransform Tree::getSpawnPointTransformation(uint depth)
+{
+    return spawn_transformations_.power(getSpawnPointTransformation(), depth);
+}
+
+QTransform Tree::getInverseSpawnPointTransformation(uint depth)
+{
+    return spawn_transformations_.inversePower(getSpawnPointTransformation(), depth);
+}
+
 void Tree::deleteLeaf(std::shared_ptr<Leaf> leaf)
 {
     for (auto &branch : branches_) {
@@ -2,10 +2,12 @@
 // Distributed under GPL-3.0
 // Copyright (C) 2023-2024  Vesko Milev
 
+#include <QPainter>
+
+#include "gfx/tree.h"
 #include "leaf_identifier.h"
 
-LeafIdentifier::LeafIdentifier() :
-    next_unused_color_(kInitialColor)
+LeafIdentifier::LeafIdentifier()
 {
 
 }
@@ -15,34 +17,74 @@ LeafIdentifier::~LeafIdentifier()
 
 }
 
-QColor LeafIdentifier::registerLeaf(std::shared_ptr<Leaf> leaf)
+uint32_t LeafIdentifier::registerLeaf(std::shared_ptr<Leaf> leaf)
 {
-    if (next_unused_color_ == kBackgroundColor) {
-        // TODO: add wraparound functionality if someone ever adds enough leaves manually to 'overflow' the RNG
-        return QColor("invalid color");
+    uint32_t index;
+
+    if (!free_slots_.empty()) {
+        index = free_slots_.front();
+        free_slots_.pop_front();
+    } else if (slots_.size() < kMaxNumSlots) {
+        index = slots_.size();
+        slots_.push_back({nullptr, 0});
+    } else {
+        return kInvalidLeafId;
     }
 
-    size_t rng = next_unused_color_.rgb();
+    slots_[index].leaf = leaf;
+
+    return (slots_[index].generation << kSlotIndexBits) | index;
+}
+
+void LeafIdentifier::unregisterLeaf(std::shared_ptr<Leaf> leaf)
+{
+    uint32_t id = leaf->getId();
 
-    // out of 3 x 8 = 24 rgb bits, first 14 bits are for the leaf, and last 10 bits are for the branch depth
-    // so shift the RNG result left by 10 bits
-    rng = (0xDABEDA * rng + 0xBABACECA) % 0x03FFFF;
-    rng <<= 10;
-    rng &= 0xFFFFFF;
+    if (getLeaf(id) == nullptr) {
+        return;
+    }
 
-    QColor display_color;
-    display_color.setRgb(rng);
+    uint32_t index = id & kSlotIndexMask;
+    slots_[index].leaf = nullptr;
 
-    leaf_map_.insert(std::pair<QColor, std::shared_ptr<Leaf>>(display_color, leaf));
-    goToNextColor();
+    // the slot is retired, since its next generation would wrap around to ids that have already been given out
+    if (slots_[index].generation == kGenerationMask) {
+        return;
+    }
 
-    return display_color;
+    slots_[index].generation++;
+    free_slots_.push_back(index);
 }
 
-void LeafIdentifier::unregisterLeaf(std::shared_ptr<Leaf> leaf)
+std::shared_ptr<Leaf> LeafIdentifier::getLeaf(uint32_t leaf_id) const
 {
-    QColor id = leaf->getColorId();
-    leaf_map_.erase(id);
+    uint32_t index = leaf_id & kSlotIndexMask;
+    uint32_t generation = leaf_id >> kSlotIndexBits;
+
+    if (index >= slots_.size() || slots_[index].generation != generation) {
+        return nullptr;
+    }
+
+    return slots_[index].leaf;
+}
+
+void LeafIdentifier::beginPass()
+{
+    pass_instances_.clear();
+}
+
+QColor LeafIdentifier::registerInstance(uint32_t leaf_id, uint depth)
+{
+    if (pass_instances_.size() >= kMaxNumInstances) {
+        return QColor();
+    }
+
+    pass_instances_.push_back({leaf_id, depth});
+
+    // instance numbers start from 1, since 0 is the background
+    uint32_t instance_number = pass_instances_.size();
+
+    return QColor::fromRgb((instance_number * kColorScrambler) & kColorMask);
 }
 
 std::shared_ptr<Leaf> LeafIdentifier::getLeaf(std::shared_ptr<QImage> color_id_buffer, QPointF position, uint& leaf_depth)
@@ -52,36 +94,56 @@ std::shared_ptr<Leaf> LeafIdentifier::getLeaf(std::shared_ptr<QImage> color_id_b
 
 std::shared_ptr<Leaf> LeafIdentifier::getLeaf(std::shared_ptr<QImage> color_id_buffer, QPoint position, uint& leaf_depth)
 {
-    QColor pixel_color = color_id_buffer->pixelColor(position);
-
-    // apply leaf mask - ignore branch depth information
-    QColor color_id(pixel_color.rgb() & kLeafMask);
+    leaf_depth = 0;
 
-    if (color_id == QColor::Invalid) {
-        leaf_depth = 0;
+    if (!color_id_buffer->valid(position)) {
         return nullptr;
     }
 
-    if (leaf_map_.find(color_id) == leaf_map_.end()) {
-        leaf_depth = 0;
+    // read the pixel directly, the buffer is 32 bits per pixel
+    const QRgb *scan_line = reinterpret_cast<const QRgb *>(color_id_buffer->constScanLine(position.y()));
+    uint32_t instance_number = ((scan_line[position.x()] & kColorMask) * kColorUnscrambler) & kColorMask;
+
+    if (instance_number == 0 || instance_number > pass_instances_.size()) {
         return nullptr;
     }
 
-    leaf_depth = pixel_color.rgb() & kDepthMask;
+    const InstanceId &instance = pass_instances_[instance_number - 1];
+
+    std::shared_ptr<Leaf> leaf = getLeaf(instance.leaf_id);
+    if (leaf != nullptr) {
+        leaf_depth = instance.depth;
+    }
 
-    return leaf_map_[color_id];
+    return leaf;
 }
 
-void LeafIdentifier::goToNextColor()
+std::shared_ptr<Leaf> LeafIdentifier::pick(std::shared_ptr<Tree> tree, std::shared_ptr<QImage> color_id_buffer,
+                                           const QTransform &view_transform, QPointF position, uint& leaf_depth)
 {
-    QRgb rgb = next_unused_color_.rgb();
+    QPoint pixel = position.toPoint();
+    QRect area = QRect(pixel.x() - kPickRadius, pixel.y() - kPickRadius, kPickRadius * 2 + 1, kPickRadius * 2 + 1);
+    area = area.intersected(color_id_buffer->rect());
 
-    // per QT documentation, this is an unsigned int with hex structure of AARRGGBB
-    rgb++;
+    if (area.isEmpty()) {
+        leaf_depth = 0;
+        return nullptr;
+    }
 
-    if (rgb == kBackgroundColor.rgb()) {
-        next_unused_color_ = kInitialColor;
-    } else {
-        next_unused_color_.setRgb(rgb);
+    {
+        std::shared_ptr<QPainter> color_id_painter = std::make_shared<QPainter>(color_id_buffer.get());
+
+        // the clip makes the painter discard everything outside of the area, even for instances that are partly inside it
+        color_id_painter->setClipRect(area);
+        color_id_painter->fillRect(area, kBackgroundColor);
+
+        color_id_painter->setWorldMatrixEnabled(true);
+        color_id_painter->setWorldTransform(view_transform);
+
+        tree->drawColorIds(color_id_painter, *this, area);
+
+        // the painter has to finish drawing before the buffer is read
     }
+
+    return getLeaf(color_id_buffer, pixel, leaf_depth);
 }
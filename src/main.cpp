@@ -2,6 +2,7 @@
 // Distributed under GPL-3.0
 // Copyright (C) 2023-2024  Vesko Milev
 
+#include "trace.h"
 #include "viewer.h"
 
 #include <QApplication>
@@ -9,7 +10,20 @@
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
-    Viewer w;
-    w.show();
-    return a.exec();
+
+    // tracing is opt-in; the drawing phases of the whole session are written to the given file on exit
+    if (qEnvironmentVariableIsSet("RGF_TRACE_FILE")) {
+        Tracer::instance().start(qEnvironmentVariable("RGF_TRACE_FILE"));
+    }
+
+    int result;
+    {
+        Viewer w;
+        w.show();
+        result = a.exec();
+    }
+
+    Tracer::instance().stop();
+
+    return result;
 }
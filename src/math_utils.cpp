@@ -29,6 +29,70 @@ TransformationInfo decomposeMatrix(QTransform matrix)
     return info;
 }
 
+qreal getMaxScale(const QTransform &matrix)
+{
+    // the singular values are the square roots of the eigenvalues of A^T * A, which are the roots of x^2 - trace * x + det^2
+    qreal sum_of_squares = matrix.m11() * matrix.m11() + matrix.m12() * matrix.m12() +
+                           matrix.m21() * matrix.m21() + matrix.m22() * matrix.m22();
+    qreal determinant = matrix.m11() * matrix.m22() - matrix.m12() * matrix.m21();
+    qreal discriminant = sum_of_squares * sum_of_squares - 4 * determinant * determinant;
+
+    return sqrt((sum_of_squares + sqrt(fmax(discriminant, 0))) / 2);
+}
+
+bool getFixedPoint(const QTransform &matrix, QPointF &fixed_point)
+{
+    // solve p = A * p + t, i.e. (I - A) * p = t
+    qreal a = 1 - matrix.m11();
+    qreal b = -matrix.m21();
+    qreal c = -matrix.m12();
+    qreal d = 1 - matrix.m22();
+    qreal determinant = a * d - b * c;
+
+    if (qFuzzyIsNull(determinant)) {
+        return false;
+    }
+
+    fixed_point.rx() = (matrix.dx() * d - b * matrix.dy()) / determinant;
+    fixed_point.ry() = (a * matrix.dy() - c * matrix.dx()) / determinant;
+    return true;
+}
+
+qreal getPointToSegmentDistance(QPointF point, QPointF segment_start, QPointF segment_end)
+{
+    QPointF segment = segment_end - segment_start;
+    qreal squared_length = segment.x() * segment.x() + segment.y() * segment.y();
+
+    if (qFuzzyIsNull(squared_length)) {
+        return getPointDistance(point, segment_start);
+    }
+
+    // project the point onto the segment and clamp the projection to its ends
+    QPointF relative = point - segment_start;
+    qreal t = (relative.x() * segment.x() + relative.y() * segment.y()) / squared_length;
+    t = fmax(0, fmin(1, t));
+
+    return getPointDistance(point, segment_start + segment * t);
+}
+
+bool isPointInPolygon(QPointF point, const std::vector<QPointF> &polygon)
+{
+    bool inside = false;
+
+    // count how many edges a horizontal ray from the point crosses
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        const QPointF &a = polygon[i];
+        const QPointF &b = polygon[j];
+
+        if ((a.y() > point.y()) != (b.y() > point.y()) &&
+            point.x() < (b.x() - a.x()) * (point.y() - a.y()) / (b.y() - a.y()) + a.x()) {
+            inside = !inside;
+        }
+    }
+
+    return inside;
+}
+
 void math_utils_test()
 {
     QTransform test_matrix;
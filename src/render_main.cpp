@@ -0,0 +1,193 @@
+// Regrafusion - draws graphics recursively
+// Distributed under GPL-3.0
+// Copyright (C) 2024  Vesko Milev
+
+// A command-line renderer that draws a tree offscreen and writes it to an image file, without opening the Viewer window.
+// It runs under the offscreen platform plugin, so it doesn't need a display, e.g. on build machines.
+
+#include <QCommandLineParser>
+#include <QGuiApplication>
+#include <QTextStream>
+
+#include "common.h"
+#include "renderer.h"
+#include "rgf_ctx.h"
+#include "trace.h"
+
+//!  Distance between consecutive leaves of the rendered branch, in world space
+static constexpr qreal kLeafSpacing = 20.0;
+
+//!
+//! \param name The name of a leaf type, as given on the command line
+//! \return The leaf type, or leaf_type_t::invalid if there is no such type
+//!
+static leaf_type_t parseLeafType(const QString &name)
+{
+    if (name == "circle")
+        return leaf_type_t::circle;
+    if (name == "line")
+        return leaf_type_t::line;
+    if (name == "rectangle")
+        return leaf_type_t::rectangle;
+    if (name == "path")
+        return leaf_type_t::path;
+
+    return leaf_type_t::invalid;
+}
+
+//!
+//! \param name The name of a program mode, as given on the command line
+//! \param mode A reference to the mode, which is filled in (return parameter)
+//! \return Whether there is such a mode
+//!
+static bool parseMode(const QString &name, ctx_mode_t &mode)
+{
+    if (name == "view") {
+        mode = ctx_mode_t::view;
+    } else if (name == "navigation") {
+        mode = ctx_mode_t::navigation;
+    } else if (name == "edit") {
+        mode = ctx_mode_t::edit;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+//!
+//! Parses a pair of numbers separated by a given character, e.g. a size like "1920x1080"
+//!
+//! \param text The text to parse
+//! \param separator The character between the numbers
+//! \param point A reference to the pair, which is filled in (return parameter)
+//! \return Whether the text is a valid pair
+//!
+static bool parsePair(const QString &text, QChar separator, QPointF &point)
+{
+    QStringList parts = text.split(separator);
+    if (parts.size() != 2) {
+        return false;
+    }
+
+    bool x_ok = false;
+    bool y_ok = false;
+    point = QPointF(parts[0].toDouble(&x_ok), parts[1].toDouble(&y_ok));
+
+    return x_ok && y_ok;
+}
+
+int main(int argc, char *argv[])
+{
+    // nothing is shown on the screen, so don't require one unless a platform has been chosen explicitly
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QGuiApplication app(argc, argv);
+    QGuiApplication::setApplicationName("RegrafusionRender");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders a Regrafusion tree offscreen and writes it to an image file.");
+    parser.addHelpOption();
+
+    QCommandLineOption output_option({"o", "output"}, "Image file to write; the format is deduced from its suffix.", "file",
+                                     "regrafusion.png");
+    QCommandLineOption size_option({"s", "size"}, "Size of the image in pixels.", "WxH", "1920x1080");
+    QCommandLineOption depth_option({"d", "depth"}, "How many branch instances are drawn.", "n", "100");
+    QCommandLineOption scale_option("scale", "Scale of the view.", "factor", "1");
+    QCommandLineOption offset_option("offset", "Offset of the view; the world origin is in the center by default.", "x,y");
+    QCommandLineOption adaptive_depth_option("adaptive-depth", "Stop spawning branches smaller than the given size.", "px");
+    QCommandLineOption mode_option("mode", "Program mode to draw in: view, navigation or edit.", "mode", "view");
+    QCommandLineOption trace_option("trace", "Write the drawing phases as Chrome trace-event JSON to the given file.", "file");
+    QCommandLineOption leaves_option("leaves", "Comma separated leaf types of the branch: circle, line, rectangle or path.",
+                                     "types", "circle");
+    parser.addOptions({output_option, size_option, depth_option, scale_option, offset_option, adaptive_depth_option,
+                       mode_option, leaves_option, trace_option});
+
+    parser.process(app);
+
+    QTextStream err(stderr);
+
+    QPointF size;
+    if (!parsePair(parser.value(size_option), 'x', size) || size.x() < 1 || size.y() < 1) {
+        err << "Invalid size: " << parser.value(size_option) << Qt::endl;
+        return 1;
+    }
+
+    bool depth_ok = false;
+    uint depth = parser.value(depth_option).toUInt(&depth_ok);
+    if (!depth_ok) {
+        err << "Invalid depth: " << parser.value(depth_option) << Qt::endl;
+        return 1;
+    }
+
+    bool scale_ok = false;
+    float scale = parser.value(scale_option).toFloat(&scale_ok);
+    if (!scale_ok || scale <= 0) {
+        err << "Invalid scale: " << parser.value(scale_option) << Qt::endl;
+        return 1;
+    }
+
+    QPointF offset = size / 2;
+    if (parser.isSet(offset_option) && !parsePair(parser.value(offset_option), ',', offset)) {
+        err << "Invalid offset: " << parser.value(offset_option) << Qt::endl;
+        return 1;
+    }
+
+    ctx_mode_t mode;
+    if (!parseMode(parser.value(mode_option), mode)) {
+        err << "Invalid mode: " << parser.value(mode_option) << Qt::endl;
+        return 1;
+    }
+
+    std::shared_ptr<RgfCtx> ctx = RgfCtx::createHeadless();
+    std::shared_ptr<Tree> tree = ctx->tree();
+
+    tree->setNumBranches(depth);
+
+    if (parser.isSet(adaptive_depth_option)) {
+        bool threshold_ok = false;
+        qreal threshold_px = parser.value(adaptive_depth_option).toDouble(&threshold_ok);
+        if (!threshold_ok || threshold_px <= 0) {
+            err << "Invalid adaptive depth threshold: " << parser.value(adaptive_depth_option) << Qt::endl;
+            return 1;
+        }
+
+        tree->setAdaptiveDepth(true);
+        tree->setAdaptiveDepthThreshold(threshold_px);
+    }
+
+    QStringList leaf_names = parser.value(leaves_option).split(',', Qt::SkipEmptyParts);
+    for (int i = 0; i < leaf_names.size(); i++) {
+        leaf_type_t leaf_type = parseLeafType(leaf_names[i]);
+        if (leaf_type == leaf_type_t::invalid) {
+            err << "Invalid leaf type: " << leaf_names[i] << Qt::endl;
+            return 1;
+        }
+
+        tree->createLeaf(leaf_type, QPointF(0, i * kLeafSpacing), 1.0);
+    }
+
+    View view = {size, offset, scale};
+    FrameRequest request = {tree, view, {mode, 0, scale}, tree->getRevision()};
+
+    if (parser.isSet(trace_option)) {
+        Tracer::instance().start(parser.value(trace_option));
+    }
+
+    Frame frame = Renderer::drawFrame(request);
+
+    if (parser.isSet(trace_option) && !Tracer::instance().stop()) {
+        err << "Couldn't write " << parser.value(trace_option) << Qt::endl;
+        return 1;
+    }
+
+    QString output = parser.value(output_option);
+    if (!frame.image.save(output)) {
+        err << "Couldn't write " << output << Qt::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,290 @@
+// Regrafusion - draws graphics recursively
+// Distributed under GPL-3.0
+// Copyright (C) 2024  Vesko Milev
+
+#include <cstring>
+
+#include "renderer.h"
+#include "trace.h"
+#include "uipainter.h"
+
+Renderer::Renderer(QObject *parent) :
+    QThread {parent},
+    has_pending_request_(false),
+    last_finished_frame_(nullptr),
+    ready_frame_(nullptr),
+    quit_(false)
+{
+}
+
+Renderer::~Renderer()
+{
+    {
+        QMutexLocker locker(&mutex_);
+        quit_ = true;
+        request_submitted_.wakeOne();
+    }
+
+    wait();
+}
+
+void Renderer::submit(FrameRequest request)
+{
+    QMutexLocker locker(&mutex_);
+
+    pending_request_ = std::move(request);
+    has_pending_request_ = true;
+
+    if (!isRunning()) {
+        start();
+    }
+
+    request_submitted_.wakeOne();
+}
+
+std::shared_ptr<Frame> Renderer::swapFrame(std::shared_ptr<Frame> displayed_frame)
+{
+    // declared before the locker, so that the trees are destroyed after the mutex has been unlocked
+    std::vector<std::shared_ptr<Tree>> released_trees;
+
+    QMutexLocker locker(&mutex_);
+
+    released_trees.swap(released_trees_);
+
+    if (ready_frame_ == nullptr) {
+        return displayed_frame;
+    }
+
+    if (displayed_frame != nullptr) {
+        free_frames_.push_back(displayed_frame);
+    }
+
+    std::shared_ptr<Frame> frame = ready_frame_;
+    ready_frame_ = nullptr;
+
+    return frame;
+}
+
+TreeStatistics Renderer::drawScene(std::shared_ptr<QPainter> painter, const FrameRequest &request,
+                                   std::shared_ptr<QPainter> color_id_painter)
+{
+    std::chrono::steady_clock::time_point background_start = std::chrono::steady_clock::now();
+    drawBackground(painter, request);
+    request.tree->recordBackgroundStatistics(std::chrono::steady_clock::now() - background_start);
+
+    return request.tree->draw(painter, QRectF(View::kOffsetIdentity, request.view.size), request.draw_state, color_id_painter);
+}
+
+Frame Renderer::drawFrame(const FrameRequest &request)
+{
+    // 32-bit, so that the tree is drawn in parallel tiles
+    Frame frame = {QImage(QSize(request.view.size.x(), request.view.size.y()), QImage::Format_RGB32), request, {}, true};
+
+    std::shared_ptr<QPainter> painter = std::make_shared<QPainter>(&frame.image);
+    frame.stats = drawScene(painter, request);
+    painter->end();
+
+    return frame;
+}
+
+void Renderer::drawBackground(std::shared_ptr<QPainter> painter, const FrameRequest &request)
+{
+    TraceZone zone("background", "render");
+
+    const View &view = request.view;
+
+    painter->setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
+    painter->fillRect(QRectF(View::kOffsetIdentity, view.size), Qt::white);
+
+    if (request.draw_state.mode != ctx_mode_t::view) {
+        UiPainter uipainter(view, painter);
+        uipainter.drawGridAndAxes();
+    }
+
+    // above elements are at constant relative position - they shouldn't be affected by the matrix
+    // also, grid and axes look better when they're always a single pixel wide
+    painter->setWorldMatrixEnabled(true);
+    painter->setWorldTransform(view.transform());
+}
+
+void Renderer::run()
+{
+    // a single painter draws every frame and every chunk of an incremental draw, so that none of them allocates one
+    std::shared_ptr<QPainter> painter = std::make_shared<QPainter>();
+
+    FrameRequest request;
+
+    while (true) {
+        std::shared_ptr<Frame> frame;
+
+        {
+            QMutexLocker locker(&mutex_);
+
+            while (!has_pending_request_ && !quit_) {
+                request_submitted_.wait(&mutex_);
+            }
+
+            // the previous request's snapshot may not be referred to by anything else anymore
+            releaseTree(std::move(request.tree));
+
+            if (quit_) {
+                return;
+            }
+
+            request = std::move(pending_request_);
+            pending_request_ = {};
+            has_pending_request_ = false;
+
+            frame = takeFreeFrame();
+        }
+
+        QSize size(request.view.size.x(), request.view.size.y());
+        if (frame->image.size() != size) {
+            // 32-bit, so that the tree is drawn in parallel tiles
+            frame->image = QImage(size, QImage::Format_RGB32);
+        }
+
+        // while the view is being panned, only the strips that have just become visible are drawn
+        QRegion drawn_area = scrollLastFrame(*frame, request);
+
+        // if the view is back where the last finished frame was drawn (e.g. it's been panned away and back), the copy is the
+        // whole frame already; an empty area would mean the whole visible area to the tree, so nothing is drawn at all
+        bool copied_entirely = drawn_area.isEmpty();
+
+        if (copied_entirely) {
+            QMutexLocker locker(&mutex_);
+
+            // the new snapshot is never compiled, so leaves couldn't be picked from it; the last finished frame's tree is of the
+            // same revision and has been compiled for the same view, and its statistics are those of the copied frame
+            releaseTree(std::move(request.tree));
+            request.tree = last_finished_frame_->request.tree;
+        }
+
+        if (!copied_entirely) {
+            painter->begin(&frame->image);
+            painter->setClipRegion(drawn_area);
+
+            std::chrono::steady_clock::time_point background_start = std::chrono::steady_clock::now();
+            drawBackground(painter, request);
+            request.tree->recordBackgroundStatistics(std::chrono::steady_clock::now() - background_start);
+
+            request.tree->beginDraw(painter, QRectF(View::kOffsetIdentity, request.view.size), request.draw_state, drawn_area);
+        }
+
+        // deep trees are drawn over several frames; every frame that runs out of time is displayed as it is,
+        // and the next one continues where it stopped
+        while (true) {
+            bool finished = copied_entirely || request.tree->drawNext(painter, kFrameBudget);
+            if (painter->isActive()) {
+                painter->end();
+            }
+
+            frame->request = request;
+            frame->stats = request.tree->getStatistics();
+            frame->complete = finished;
+
+            QMutexLocker locker(&mutex_);
+
+            // a new request cancels the draw in progress
+            if (!finished && (has_pending_request_ || quit_)) {
+                free_frames_.push_back(frame);
+                break;
+            }
+
+            std::shared_ptr<Frame> next_frame = finished ? nullptr : takeFreeFrame();
+
+            // a frame that hasn't been displayed yet is stale now
+            if (ready_frame_ != nullptr) {
+                free_frames_.push_back(ready_frame_);
+            }
+
+            ready_frame_ = frame;
+
+            if (finished) {
+                last_finished_frame_ = frame;
+            }
+
+            locker.unlock();
+
+            emit frameReady();
+
+            if (finished) {
+                break;
+            }
+
+            // the ready frame is only ever read, so it can be copied without holding the lock
+            if (next_frame->image.size() == frame->image.size()) {
+                std::memcpy(next_frame->image.bits(), frame->image.constBits(), frame->image.sizeInBytes());
+            } else {
+                next_frame->image = frame->image.copy();
+            }
+
+            frame = next_frame;
+            painter->begin(&frame->image);
+            painter->setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
+            painter->setClipRegion(drawn_area);
+            painter->setWorldTransform(request.view.transform());
+        }
+    }
+}
+
+std::shared_ptr<Frame> Renderer::takeFreeFrame()
+{
+    // the last finished frame may still have to be shifted into the next one, so it isn't drawn onto
+    for (auto it = free_frames_.begin(); it != free_frames_.end(); it++) {
+        if (*it != last_finished_frame_) {
+            std::shared_ptr<Frame> frame = *it;
+            free_frames_.erase(it);
+
+            // the frame is going to be drawn for another request
+            releaseTree(std::move(frame->request.tree));
+            return frame;
+        }
+    }
+
+    return std::make_shared<Frame>();
+}
+
+void Renderer::releaseTree(std::shared_ptr<Tree> tree)
+{
+    if (tree != nullptr) {
+        released_trees_.push_back(std::move(tree));
+    }
+}
+
+QRegion Renderer::scrollLastFrame(Frame &frame, const FrameRequest &request) const
+{
+    QRect frame_rect = frame.image.rect();
+
+    if (last_finished_frame_ == nullptr) {
+        return frame_rect;
+    }
+
+    const FrameRequest &last_request = last_finished_frame_->request;
+    const QImage &last_image = last_finished_frame_->image;
+
+    // anything but the offset changes what is drawn everywhere
+    if (last_request.revision != request.revision || !(last_request.draw_state == request.draw_state) ||
+        last_request.view.size != request.view.size || last_request.view.scale != request.view.scale ||
+        last_image.size() != frame.image.size() || last_image.format() != frame.image.format()) {
+        return frame_rect;
+    }
+
+    QPointF offset_delta = request.view.offset - last_request.view.offset;
+    QPoint shift(qRound(offset_delta.x()), qRound(offset_delta.y()));
+
+    if (qAbs(offset_delta.x() - shift.x()) > kMaxScrollError || qAbs(offset_delta.y() - shift.y()) > kMaxScrollError ||
+        qAbs(shift.x()) >= frame_rect.width() || qAbs(shift.y()) >= frame_rect.height()) {
+        return frame_rect;
+    }
+
+    // the part of the last frame that is still visible, in the space of the new one; frames are 32-bit
+    QRect kept_rect = frame_rect.intersected(frame_rect.translated(shift));
+    for (int y = kept_rect.top(); y <= kept_rect.bottom(); y++) {
+        std::memcpy(frame.image.scanLine(y) + kept_rect.left() * sizeof(QRgb),
+                    last_image.constScanLine(y - shift.y()) + (kept_rect.left() - shift.x()) * sizeof(QRgb),
+                    kept_rect.width() * sizeof(QRgb));
+    }
+
+    return QRegion(frame_rect).subtracted(kept_rect);
+}
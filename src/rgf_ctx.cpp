@@ -7,23 +7,16 @@
 
 #include "rgf_ctx.h"
 
-RgfCtx::RgfCtx(DisplayWidget *display_widget, QStatusBar* status_bar) :
+RgfCtx::RgfCtx(DisplayWidget *display_widget, QStatusBar* status_bar, QSize buffer_size) :
     display_widget_(display_widget),
     status_bar_(status_bar),
     leaf_identifier_(std::make_shared<LeafIdentifier>()),
     tree_(nullptr),
-    user_view_buffer_(std::make_shared<QImage>(
-        QGuiApplication::primaryScreen()->geometry().width(),
-        QGuiApplication::primaryScreen()->geometry().height(),
-        QImage::Format_RGB32)),
-    color_id_buffer_(std::make_shared<QImage>(
-        QGuiApplication::primaryScreen()->geometry().width(),
-        QGuiApplication::primaryScreen()->geometry().height(),
-        QImage::Format_RGB32)),
+    user_view_buffer_(std::make_shared<QImage>(buffer_size, QImage::Format_RGB32)),
+    color_id_buffer_(std::make_shared<QImage>(buffer_size, QImage::Format_RGB32)),
     mode_(mode_t::navigation),
     selected_leaf_(nullptr),
-    selected_leaf_depth_(0),
-    cumulative_branch_transformations_(QTransform())
+    selected_leaf_depth_(0)
 {
     assert(user_view_buffer_ != nullptr && color_id_buffer_ != nullptr && "Couldn't allocate drawing bufffers");
 }
@@ -32,17 +25,33 @@ std::shared_ptr<RgfCtx> RgfCtx::create(DisplayWidget *display_widget, QStatusBar
 {
     // just a wrapper to get to the private ctor
     struct ctor : public RgfCtx {
-        ctor(DisplayWidget *display_widget, QStatusBar* status_bar) :
-            RgfCtx {display_widget, status_bar} {}
+        ctor(DisplayWidget *display_widget, QStatusBar* status_bar, QSize buffer_size) :
+            RgfCtx {display_widget, status_bar, buffer_size} {}
     };
 
-    std::shared_ptr<RgfCtx> ctx = std::make_shared<ctor>(display_widget, status_bar);
+    std::shared_ptr<RgfCtx> ctx = std::make_shared<ctor>(display_widget, status_bar,
+                                                         QGuiApplication::primaryScreen()->geometry().size());
     ctx->tree_ = std::make_shared<Tree>(ctx, 100);
     display_widget->setRgfCtx(ctx);
 
     return ctx;
 }
 
+std::shared_ptr<RgfCtx> RgfCtx::createHeadless()
+{
+    // just a wrapper to get to the private ctor
+    struct ctor : public RgfCtx {
+        ctor() :
+            RgfCtx {nullptr, nullptr, QSize()} {}
+    };
+
+    // headless contexts draw onto images of their own, so the buffers are left empty
+    std::shared_ptr<RgfCtx> ctx = std::make_shared<ctor>();
+    ctx->tree_ = std::make_shared<Tree>(ctx, 100);
+
+    return ctx;
+}
+
 RgfCtx::~RgfCtx()
 {
 }
@@ -52,6 +61,16 @@ void RgfCtx::setNumBranches(uint num_branches)
     tree_->setNumBranches(num_branches);
 }
 
+void RgfCtx::setAdaptiveDepth(bool enabled)
+{
+    tree_->setAdaptiveDepth(enabled);
+}
+
+void RgfCtx::setAdaptiveDepthThreshold(qreal threshold_px)
+{
+    tree_->setAdaptiveDepthThreshold(threshold_px);
+}
+
 void RgfCtx::switchModes()
 {
     switch(mode_) {
@@ -79,68 +98,88 @@ void RgfCtx::createLeaf(leaf_type_t leaf_type, QPointF position, qreal scale)
         return;
     }
 
-    display_widget_->update();
-    display_widget_->updateStatus();
+    refreshWithStatus();
 
     emit leafSelected(leaf, 0);
 }
 
 void RgfCtx::createLeaf(leaf_type_t leaf_type)
 {
-    View view = display_widget_->getView();
+    View view = getView();
     createLeaf(leaf_type, view.size / 2 - view.offset, view.scale);
 }
 
+View RgfCtx::getView() const
+{
+    if (display_widget_ == nullptr) {
+        return {View::kOffsetIdentity, View::kOffsetIdentity, 1.0};
+    }
+
+    return display_widget_->getView();
+}
+
 void RgfCtx::refresh()
 {
-    display_widget_->update();
+    if (display_widget_ == nullptr) {
+        return;
+    }
+
+    display_widget_->refresh();
 }
 
-void RgfCtx::setSelectedLeaf(std::shared_ptr<Leaf> leaf, uint leaf_depth)
+void RgfCtx::refreshWithStatus()
 {
-    selected_leaf_ = leaf;
-    selected_leaf_depth_ = leaf_depth;
-    cumulative_branch_transformations_ = QTransform();
+    if (display_widget_ == nullptr) {
+        return;
+    }
 
-    if (selected_leaf_ != nullptr) {
-        QTransform spawn_tfm = tree_->getSpawnPointTransformation();
+    display_widget_->refresh();
+    display_widget_->updateStatus();
+}
 
-        for (uint i = 0; i < leaf_depth; i++) {
-            cumulative_branch_transformations_ *= spawn_tfm;
-        }
+void RgfCtx::setStatusBarMessage(const QString& message)
+{
+    if (status_bar_ == nullptr) {
+        return;
     }
 
+    status_bar_->showMessage(message);
+}
+
+void RgfCtx::setSelectedLeaf(std::shared_ptr<Leaf> leaf, uint leaf_depth)
+{
+    selected_leaf_ = leaf;
+    selected_leaf_depth_ = leaf_depth;
+
     emit leafSelected(leaf, leaf_depth);
 }
 
 QPointF RgfCtx::toSelectedBranchSpace(QPointF coordinate)
 {
-    return cumulative_branch_transformations_.inverted().map(coordinate);
+    return tree_->getInverseSpawnPointTransformation(selected_leaf_depth_).map(coordinate);
 }
 
 void RgfCtx::deleteLeafAction()
 {
     if (getMode() != RgfCtx::mode_t::edit) {
-        status_bar_->showMessage("You need to be in edit mode in order to delete shapes");
+        setStatusBarMessage("You need to be in edit mode in order to delete shapes");
         return;
     }
 
     auto leaf = getSelectedLeaf();
     if (leaf == nullptr) {
-        status_bar_->showMessage("No shape is selected");
+        setStatusBarMessage("No shape is selected");
         return;
     }
 
     deleteLeaf(leaf);
-    display_widget_->update();
-    display_widget_->updateStatus();
+    refreshWithStatus();
 }
 
 void RgfCtx::switchModesAction()
 {
     switchModes();
-    display_widget_->update();
-    display_widget_->updateStatus();
+    refreshWithStatus();
 }
 
 void RgfCtx::deleteLeaf(std::shared_ptr<Leaf> leaf)
@@ -0,0 +1,149 @@
+// Regrafusion - draws graphics recursively
+// Distributed under GPL-3.0
+// Copyright (C) 2024  Vesko Milev
+
+#include <algorithm>
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+
+#include "trace.h"
+
+std::atomic<bool> Tracer::enabled_ = false;
+
+Tracer::Tracer() :
+    num_events_(0),
+    num_dropped_events_(0)
+{
+}
+
+Tracer& Tracer::instance()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::start(const QString &path)
+{
+    QMutexLocker locker(&mutex_);
+
+    path_ = path;
+    start_time_ = std::chrono::steady_clock::now();
+
+    // buffers that only the tracer refers to belong to threads that have finished
+    buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                  [](const std::shared_ptr<ThreadBuffer> &buffer) { return buffer.use_count() == 1; }),
+                   buffers_.end());
+
+    for (const std::shared_ptr<ThreadBuffer> &buffer : buffers_) {
+        QMutexLocker buffer_locker(&buffer->mutex);
+        buffer->events.clear();
+    }
+
+    num_events_ = 0;
+    num_dropped_events_ = 0;
+
+    enabled_ = true;
+}
+
+bool Tracer::stop()
+{
+    QMutexLocker locker(&mutex_);
+
+    if (!enabled_) {
+        return false;
+    }
+
+    enabled_ = false;
+
+    QFile file(path_);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    auto to_us = [](std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / 1000.0;
+    };
+
+    // the events can be numerous, so they're streamed instead of being built into a JSON document first
+    QTextStream out(&file);
+    out.setRealNumberNotation(QTextStream::FixedNotation);
+    out.setRealNumberPrecision(3);
+
+    out << "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"droppedEvents\":" << num_dropped_events_.load()
+        << "},\"traceEvents\":[";
+
+    qint64 pid = QCoreApplication::applicationPid();
+    bool first_event = true;
+
+    // threads are numbered in the order they first recorded something; trace viewers sort events by their timestamps anyway
+    for (size_t thread_number = 0; thread_number < buffers_.size(); thread_number++) {
+        ThreadBuffer &buffer = *buffers_[thread_number];
+        QMutexLocker buffer_locker(&buffer.mutex);
+
+        for (const TraceEvent &event : buffer.events) {
+            out << (first_event ? "\n" : ",\n")
+                << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category << "\",\"ph\":\"X\""
+                << ",\"ts\":" << to_us(event.start - start_time_) << ",\"dur\":" << to_us(event.duration)
+                << ",\"pid\":" << pid << ",\"tid\":" << thread_number << ",\"args\":{";
+            first_event = false;
+
+            bool first_arg = true;
+            for (const TraceArg &arg : event.args) {
+                if (arg.name == nullptr) {
+                    continue;
+                }
+
+                out << (first_arg ? "" : ",") << "\"" << arg.name << "\":" << arg.value;
+                first_arg = false;
+            }
+
+            out << "}}";
+        }
+
+        buffer.events.clear();
+        buffer.events.shrink_to_fit();
+    }
+
+    out << "\n]}\n";
+    out.flush();
+
+    return out.status() == QTextStream::Ok;
+}
+
+void Tracer::record(const char *name, const char *category, std::chrono::steady_clock::time_point start,
+                    std::chrono::steady_clock::time_point end, TraceArg arg, TraceArg arg2)
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    if (num_events_.fetch_add(1, std::memory_order_relaxed) >= kMaxEvents) {
+        num_dropped_events_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ThreadBuffer &buffer = threadBuffer();
+    QMutexLocker locker(&buffer.mutex);
+
+    // recording may have been stopped since the check above
+    if (!enabled_) {
+        return;
+    }
+
+    buffer.events.push_back({name, category, start, end - start, {arg, arg2}});
+}
+
+Tracer::ThreadBuffer& Tracer::threadBuffer()
+{
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+
+    if (buffer == nullptr) {
+        buffer = std::make_shared<ThreadBuffer>();
+
+        QMutexLocker locker(&mutex_);
+        buffers_.push_back(buffer);
+    }
+
+    return *buffer;
+}
@@ -4,7 +4,9 @@
 
 #include "uipainter.h"
 
+#include "allocation_counter.h"
 #include "common.h"
+#include "trace.h"
 #include "view.h"
 
 UiPainter::UiPainter(View view, std::shared_ptr<QPainter>  painter) :
@@ -74,6 +76,8 @@ void UiPainter::scaleGrid()
 
 void UiPainter::drawGridAndAxes()
 {
+    TraceZone zone("grid", "ui");
+
     float left_edge = -view_.offset.x();
     float right_edge = view_.size.x() - view_.offset.x();
     float top_edge = -view_.offset.y();
@@ -173,6 +177,8 @@ void UiPainter::drawCoordinateLabels()
 
 void UiPainter::drawRulerNumbers()
 {
+    TraceZone zone("rulers", "ui");
+
     float left_edge = ruler_text_width_;
     float right_edge = view_.size.x() - kLabelsOffset;
     float top_edge = kLabelsOffset;
@@ -254,19 +260,34 @@ void UiPainter::drawRulerNumbers()
     }
 }
 
-void UiPainter::drawStats(TreeStatistics& stats)
+void UiPainter::drawStats(const TreeStatistics& stats, const PaintStatistics& paint_stats)
 {
-    int avg_time_to_draw_tree = vector_average<uint>(stats.render_time_us);
-    int avg_time_to_draw_first_branch = vector_average<uint>(stats.first_branch_render_time_us);
-    int avg_time_to_draw_last_branch = vector_average<uint>(stats.last_branch_render_time_us);
-    int avg_time_to_draw_branch = vector_average<uint>(stats.avg_branch_render_time_us);
+    // the tail of the distribution shows hitches, which an average hides
+    auto percentiles = [](const TreeStatistics::Samples &samples) {
+        return "p50 " + QString::number(samples.percentile(50)) + "µs, " +
+               "p95 " + QString::number(samples.percentile(95)) + "µs, " +
+               "p99 " + QString::number(samples.percentile(99)) + "µs, " +
+               "max " + QString::number(samples.max()) + "µs";
+    };
+
+    auto median_and_tail = [](const TreeStatistics::Samples &samples) {
+        return QString::number(samples.percentile(50)) + "/" + QString::number(samples.percentile(99)) + "µs";
+    };
 
     painter_->setPen(Qt::black);
     painter_->drawText(QRectF(kLabelsOffset, kLabelsOffset * 1.5, view_.size.x(), view_.size.y()),
-                      "Average time to render the tree: " + QString::number(avg_time_to_draw_tree) + "µs\n" +
-                      "Average time to render a branch: " + QString::number(avg_time_to_draw_branch) + "µs\n" +
-                      "Average time to render first branch: " + QString::number(avg_time_to_draw_first_branch) + "µs\n" +
-                      "Average time to render last branch: " + QString::number(avg_time_to_draw_last_branch) + "µs");
+                      "Time to render the tree: " + percentiles(stats.render_time_us) + "\n" +
+                      "Time to render a branch: " + percentiles(stats.avg_branch_render_time_us) + "\n" +
+                      "Time to render first branch: " + percentiles(stats.first_branch_render_time_us) + "\n" +
+                      "Time to render last branch: " + percentiles(stats.last_branch_render_time_us) + "\n" +
+                      "Phases (p50/p99): background " + median_and_tail(stats.background_render_time_us) +
+                      ", tree " + median_and_tail(stats.render_time_us) +
+                      ", frame " + median_and_tail(paint_stats.frame_time_us) +
+                      ", overlays " + median_and_tail(paint_stats.overlay_time_us) +
+                      ", blit " + median_and_tail(paint_stats.blit_time_us) + "\n" +
+                      (kCountAllocations ? "Allocations per frame (p50/p99): " + QString::number(stats.allocations.percentile(50)) +
+                                               "/" + QString::number(stats.allocations.percentile(99)) + "\n" : QString()) +
+                      "Effective depth: " + QString::number(stats.effective_depth));
 }
 
 void UiPainter::drawCtxMode(RgfCtx::mode_t mode)
@@ -32,6 +32,10 @@ Viewer::Viewer(QWidget *parent)
     ui->num_branches_slider->setValue(num_branches);
     ctx_->setNumBranches(num_branches);
 
+    ctx_->setAdaptiveDepth(ui->adaptive_depth_check_box->isChecked());
+    ui->adaptive_depth_spin_box->setValue(Tree::kDefaultAdaptiveDepthThreshold);
+    ui->adaptive_depth_spin_box->setEnabled(ui->adaptive_depth_check_box->isChecked());
+
     setupEditors();
 
 #ifndef QT_DEBUG
@@ -59,20 +63,33 @@ void Viewer::on_num_branches_slider_valueChanged(int value)
 {
     ui->num_branches_spin_box->setValue(value);
     ctx_->setNumBranches(value);
-    ui->display_widget->update();
+    ui->display_widget->refresh();
 }
 
 void Viewer::on_num_branches_spin_box_valueChanged(int arg1)
 {
     ui->num_branches_slider->setValue(arg1);
     ctx_->setNumBranches(arg1);
-    ui->display_widget->update();
+    ui->display_widget->refresh();
+}
+
+void Viewer::on_adaptive_depth_check_box_toggled(bool checked)
+{
+    ui->adaptive_depth_spin_box->setEnabled(checked);
+    ctx_->setAdaptiveDepth(checked);
+    ui->display_widget->refresh();
+}
+
+void Viewer::on_adaptive_depth_spin_box_valueChanged(double arg1)
+{
+    ctx_->setAdaptiveDepthThreshold(arg1);
+    ui->display_widget->refresh();
 }
 
 void Viewer::on_switch_buffers_pressed()
 {
     ui->display_widget->switchBuffers();
-    ui->display_widget->update();
+    ui->display_widget->refresh();
 }
 
 void Viewer::onRgfCtxModeSwitched()
@@ -149,22 +166,22 @@ void Viewer::setupEditors()
     // setup the transformation editor first
     uint next_free_row = getNextFreeRowInGridLayout();
     tfm_editor_ = std::make_shared<TransformEditor>(ui->gridLayout, next_free_row);
-    connect(tfm_editor_.get(), &Editor::propertyEdited, ui->display_widget, &DisplayWidget::paintGL);
+    connect(tfm_editor_.get(), &Editor::propertyEdited, ui->display_widget, &DisplayWidget::refresh);
 
     // all other editors are going to use the same slot
     next_free_row++;
 
     circle_editor_ = std::make_shared<CircleEditor>(ui->gridLayout, next_free_row);
-    connect(circle_editor_.get(), &Editor::propertyEdited, ui->display_widget, &DisplayWidget::paintGL);
+    connect(circle_editor_.get(), &Editor::propertyEdited, ui->display_widget, &DisplayWidget::refresh);
 
     line_editor_ = std::make_shared<LineEditor>(ui->gridLayout, next_free_row);
-    connect(line_editor_.get(), &Editor::propertyEdited, ui->display_widget, &DisplayWidget::paintGL);
+    connect(line_editor_.get(), &Editor::propertyEdited, ui->display_widget, &DisplayWidget::refresh);
 
     rectangle_editor_ = std::make_shared<RectangleEditor>(ui->gridLayout, next_free_row);
-    connect(rectangle_editor_.get(), &Editor::propertyEdited, ui->display_widget, &DisplayWidget::paintGL);
+    connect(rectangle_editor_.get(), &Editor::propertyEdited, ui->display_widget, &DisplayWidget::refresh);
 
     path_editor_ = std::make_shared<PathEditor>(ui->gridLayout, next_free_row);
-    connect(path_editor_.get(), &Editor::propertyEdited, ui->display_widget, &DisplayWidget::paintGL);
+    connect(path_editor_.get(), &Editor::propertyEdited, ui->display_widget, &DisplayWidget::refresh);
 
     // since there is no auto-adjusting of the spacer's row, set it manually to row 100
     ui->gridLayout->removeItem(ui->verticalSpacer);